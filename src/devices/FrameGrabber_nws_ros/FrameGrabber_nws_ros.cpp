@@ -11,7 +11,7 @@
 
 #include <yarp/dev/PolyDriver.h>
 
-#include <rosPixelCode.h>
+#include <RGBDRosConversionUtils.h>
 
 namespace {
 YARP_LOG_COMPONENT(FRAMEGRABBER_NWS_ROS, "yarp.device.frameGrabber_nws_ros")
@@ -45,6 +45,8 @@ bool FrameGrabber_nws_ros::close()
     publisherPort_cameraInfo.interrupt();
     publisherPort_cameraInfo.close();
 
+    m_compressedImage.reset();
+
     if (node != nullptr) {
         node->interrupt();
         delete node;
@@ -122,6 +124,30 @@ bool FrameGrabber_nws_ros::open(yarp::os::Searchable& config)
     }
     m_frameId = config.find("frame_id").asString();
 
+    // Check "jpeg_compression" options and open the compressed image publisher
+    if (config.check("jpeg_compression") && config.find("jpeg_compression").asBool()) {
+        if (!yarp::dev::RosImageCompression::JpegEncoder::available()) {
+            yCError(FRAMEGRABBER_NWS_ROS) << "jpeg_compression is not available: the device was built without libjpeg";
+            return false;
+        }
+        const int quality = config.check("jpeg_quality") ? config.find("jpeg_quality").asInt32() : 80;
+        if (quality < 1 || quality > 100) {
+            yCError(FRAMEGRABBER_NWS_ROS) << "jpeg_quality must be in [1, 100]";
+            return false;
+        }
+        const int threads = config.check("jpeg_threads") ? config.find("jpeg_threads").asInt32() : 2;
+        if (threads < 1) {
+            yCError(FRAMEGRABBER_NWS_ROS) << "jpeg_threads must be at least 1";
+            return false;
+        }
+        m_compressedImage = std::make_unique<yarp::dev::RosImageCompression::CompressedImagePublisher>(quality, static_cast<size_t>(threads));
+        std::string compressedTopicName = topicName + "/compressed";
+        if (!m_compressedImage->open(compressedTopicName, m_frameId)) {
+            yCError(FRAMEGRABBER_NWS_ROS) << "Unable to publish data on" << compressedTopicName << "topic, check your yarp-ROS network configuration";
+            return false;
+        }
+    }
+
     yCInfo(FRAMEGRABBER_NWS_ROS) << "Running, waiting for attach...";
 
     m_active = true;
@@ -174,6 +200,7 @@ bool FrameGrabber_nws_ros::threadInit()
 
 void FrameGrabber_nws_ros::threadRelease()
 {
+    publisherPort_image.waitForWrite();
     delete img;
     img = nullptr;
 }
@@ -182,7 +209,9 @@ void FrameGrabber_nws_ros::threadRelease()
 // Publish the images on the buffered port
 void FrameGrabber_nws_ros::run()
 {
-    if (publisherPort_image.getOutputCount() == 0 && publisherPort_cameraInfo.getOutputCount() == 0) {
+    const bool imageWanted = publisherPort_image.getOutputCount() > 0;
+    const bool compressedWanted = m_compressedImage && m_compressedImage->getOutputCount() > 0;
+    if (!imageWanted && !compressedWanted && publisherPort_cameraInfo.getOutputCount() == 0) {
         // If no ports are connected, do not call getImage on the interface.
         return;
     }
@@ -193,24 +222,24 @@ void FrameGrabber_nws_ros::run()
         m_stamp.update(yarp::os::Time::now());
     }
 
-    if (iFrameGrabberImage && publisherPort_image.getOutputCount() > 0) {
+    if (iFrameGrabberImage && (imageWanted || compressedWanted)) {
+        // The previous message is serialized straight from img, wait until it is sent
+        publisherPort_image.waitForWrite();
         iFrameGrabberImage->getImage(*img);
-        auto& image = publisherPort_image.prepare();
-
-        image.data.resize(img->getRawImageSize());
-        image.width = img->width();
-        image.height = img->height();
-        image.encoding = yarp::dev::ROSPixelCode::yarp2RosPixelCode(img->getPixelCode());
-        image.step = img->getRowSize();
-        image.header.frame_id = m_frameId;
-        image.header.stamp = m_stamp.getTime();
-        image.header.seq = m_stamp.getCount();
-        image.is_bigendian = 0;
-
-        memcpy(image.data.data(), img->getRawImage(), img->getRawImageSize());
-
-        publisherPort_image.setEnvelope(m_stamp);
-        publisherPort_image.write();
+
+        if (imageWanted) {
+            auto& image = publisherPort_image.prepare();
+
+            yarp::dev::RGBDRosConversionUtils::shallowCopyImages(*img, image, m_frameId, m_stamp.getTime(), m_stamp.getCount());
+
+            publisherPort_image.setEnvelope(m_stamp);
+            publisherPort_image.write();
+        }
+
+        if (compressedWanted) {
+            // Copied and encoded by the publisher threads
+            m_compressedImage->post(*img, m_stamp, m_stamp.getCount());
+        }
     }
 
     if (iRgbVisualParams && publisherPort_cameraInfo.getOutputCount() > 0) {
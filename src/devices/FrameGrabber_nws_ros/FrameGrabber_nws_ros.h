@@ -23,6 +23,11 @@
 #include <yarp/rosmsg/sensor_msgs/CameraInfo.h>
 #include <yarp/rosmsg/sensor_msgs/Image.h>
 
+#include <rosImageWire.h>
+#include <compressedImagePublisher.h>
+
+#include <memory>
+
 /**
  * @ingroup dev_impl_nws_ros
  *
@@ -36,6 +41,9 @@
  * | node_name       | String | -       | -             | Yes       | the name of the ros node                 | must begin with /      |
  * | topic_name      | String | -       | -             | Yes       | the name of the ros topic                | must begin with /      |
  * | frame_id        | String | -       | -             | Yes       | the frame where the grabber is placed    |       |
+ * | jpeg_compression | bool  | -       | false         | No        | also publish jpeg images on <topic_name>/compressed | requires libjpeg, compatible with the compressed plugin of image_transport, encoded only while the topic has subscribers |
+ * | jpeg_quality    | int    | -       | 80            | No        | jpeg quality (1-100)                     |       |
+ * | jpeg_threads    | int    | -       | 2             | No        | number of threads encoding the jpeg images |     |
  *
  */
 
@@ -46,12 +54,13 @@ class FrameGrabber_nws_ros :
 {
 private:
     // Publishers
-    typedef yarp::os::Publisher<yarp::rosmsg::sensor_msgs::Image> ImageTopicType;
+    typedef yarp::os::Publisher<yarp::dev::RGBDRosConversionUtils::ImageWire> ImageTopicType;
     typedef yarp::os::Publisher<yarp::rosmsg::sensor_msgs::CameraInfo> CameraInfoTopicType;
 
     yarp::os::Node* node {nullptr};
     ImageTopicType publisherPort_image;
     CameraInfoTopicType publisherPort_cameraInfo;
+    std::unique_ptr<yarp::dev::RosImageCompression::CompressedImagePublisher> m_compressedImage;
 
     // Interfaces handled
     yarp::dev::IRgbVisualParams* iRgbVisualParams {nullptr};
@@ -7,14 +7,19 @@
 #include <algorithm>
 #include <iomanip>
 #include <cstdint>
+#include <chrono>
 
 #include <yarp/os/LogComponent.h>
+#include <yarp/os/Time.h>
 #include <yarp/os/Value.h>
 #include <yarp/sig/ImageUtils.h>
 #include <yarp/dev/RGBDSensorParamParser.h>
 
 #include "RGBDRosConversionUtils.h"
 #include "rosPixelCode.h"
+#include "depthConversion.h"
+#include "pixelConversion.h"
+#include "cpuFeatures.h"
 
 using namespace yarp::dev;
 using namespace yarp::sig;
@@ -23,6 +28,251 @@ using namespace yarp::dev::RGBDRosConversionUtils;
 
 namespace {
 YARP_LOG_COMPONENT(RGBD_ROS, "yarp.device.RGBDRosConversion")
+
+// Checks that the payload of a ROS image holds `height` rows of `step` bytes,
+// each one large enough for `width` pixels of `pixelSize` bytes.
+// A zero step (sent by some publishers) is interpreted as tightly packed rows.
+bool checkRosImageLayout(const yarp::rosmsg::sensor_msgs::Image& v, size_t pixelSize)
+{
+    const size_t rowBytes = v.width * pixelSize;
+    const size_t srcStep = (v.step != 0) ? v.step : rowBytes;
+    if (srcStep < rowBytes)
+    {
+        yCError(RGBD_ROS) << "Invalid step" << v.step << "for a" << v.width << "pixels wide" << v.encoding << "image";
+        return false;
+    }
+    if (v.height > 0 && v.data.size() < srcStep * (v.height - 1) + rowBytes)
+    {
+        yCError(RGBD_ROS) << "Truncated" << v.encoding << "image: got" << v.data.size() << "bytes, expected" << srcStep * v.height;
+        return false;
+    }
+    return true;
+}
+
+// The part of a ROS image that is converted: `width` x `height` output pixels, the pixel (c, r)
+// being the source one at `data + r * decimation * step + c * decimation * pixelSize`.
+struct RosImageView
+{
+    const unsigned char* data = nullptr;
+    size_t step = 0;
+    size_t pixelSize = 0;
+    size_t width = 0;
+    size_t height = 0;
+    size_t decimation = 1;
+
+    const unsigned char* row(size_t r) const { return data + r * decimation * step; }
+    bool packed() const { return decimation == 1 && step == width * pixelSize; }
+};
+
+RosImageView makeView(const yarp::rosmsg::sensor_msgs::Image& v, size_t pixelSize, size_t x0, size_t y0, size_t width, size_t height, size_t decimation)
+{
+    RosImageView view;
+    view.step = (v.step != 0) ? v.step : v.width * pixelSize;
+    view.pixelSize = pixelSize;
+    view.data = v.data.data() + y0 * view.step + x0 * pixelSize;
+    view.width = width;
+    view.height = height;
+    view.decimation = decimation;
+    return view;
+}
+
+// Copies the pixels of a view into an already resized YARP image.
+// When the rows are contiguous in both images the whole payload is moved with a
+// single memcpy, otherwise the rows (or the pixels, if decimated) are copied one by one.
+void copyRows(const RosImageView& view, yarp::sig::Image& dest)
+{
+    const size_t rowBytes = view.width * view.pixelSize;
+    const size_t dstStep = dest.getRowSize();
+    unsigned char* dst = dest.getRawImage();
+
+    if (view.packed() && dstStep == rowBytes)
+    {
+        memcpy(dst, view.data, rowBytes * view.height);
+    }
+    else if (view.decimation == 1)
+    {
+        for (size_t r = 0; r < view.height; r++)
+        {
+            memcpy(dst + r * dstStep, view.row(r), rowBytes);
+        }
+    }
+    else
+    {
+        const size_t pixelStride = view.decimation * view.pixelSize;
+        for (size_t r = 0; r < view.height; r++)
+        {
+            const unsigned char* src = view.row(r);
+            unsigned char* out = dst + r * dstStep;
+            for (size_t c = 0; c < view.width; c++)
+            {
+                memcpy(out + c * view.pixelSize, src + c * pixelStride, view.pixelSize);
+            }
+        }
+    }
+}
+
+typedef void (*PixelRowConversion)(const std::uint8_t*, std::uint8_t*, std::size_t);
+
+// Same as copyRows(), converting the pixels with `convert` while copying them.
+// Decimated rows are gathered in `scratch` before being converted.
+void convertRows(const RosImageView& view, yarp::sig::Image& dest, PixelRowConversion convert, std::vector<unsigned char>& scratch)
+{
+    const size_t dstStep = dest.getRowSize();
+    unsigned char* dst = dest.getRawImage();
+
+    if (view.packed() && dstStep == view.width * dest.getPixelSize())
+    {
+        convert(view.data, dst, view.width * view.height);
+    }
+    else if (view.decimation == 1)
+    {
+        for (size_t r = 0; r < view.height; r++)
+        {
+            convert(view.row(r), dst + r * dstStep, view.width);
+        }
+    }
+    else
+    {
+        const size_t pixelStride = view.decimation * view.pixelSize;
+        scratch.resize(view.width * view.pixelSize);
+        for (size_t r = 0; r < view.height; r++)
+        {
+            const unsigned char* src = view.row(r);
+            for (size_t c = 0; c < view.width; c++)
+            {
+                memcpy(scratch.data() + c * view.pixelSize, src + c * pixelStride, view.pixelSize);
+            }
+            convert(scratch.data(), dst + r * dstStep, view.width);
+        }
+    }
+}
+
+inline std::uint16_t loadDepth16(const unsigned char* p, bool swapBytes)
+{
+    std::uint16_t d;
+    memcpy(&d, p, sizeof(d));
+    return swapBytes ? static_cast<std::uint16_t>((d << 8) | (d >> 8)) : d;
+}
+
+inline float loadDepthFloat(const unsigned char* p)
+{
+    float d;
+    memcpy(&d, p, sizeof(d));
+    return d;
+}
+
+// Converts 16 bit depth samples to metres. A zero sample is an invalid measurement.
+void convertDepth16Rows(const RosImageView& view, DepthImage& dest, float scale, bool swapBytes, bool minPooling)
+{
+    if (view.packed() && dest.getRowSize() == view.width * sizeof(float))
+    {
+        convertDepth16UToFloat(reinterpret_cast<const uint16_t*>(view.data),
+                               reinterpret_cast<float*>(dest.getRawImage()),
+                               view.width * view.height, scale, swapBytes);
+        return;
+    }
+    for (size_t r = 0; r < view.height; r++)
+    {
+        const unsigned char* src = view.row(r);
+        float* out = reinterpret_cast<float*>(dest.getRow(r));
+        if (view.decimation == 1)
+        {
+            convertDepth16UToFloat(reinterpret_cast<const uint16_t*>(src), out, view.width, scale, swapBytes);
+            continue;
+        }
+        const size_t pixelStride = view.decimation * sizeof(uint16_t);
+        for (size_t c = 0; c < view.width; c++)
+        {
+            const unsigned char* block = src + c * pixelStride;
+            uint16_t depth = loadDepth16(block, swapBytes);
+            if (minPooling)
+            {
+                for (size_t by = 0; by < view.decimation; by++)
+                {
+                    const unsigned char* p = block + by * view.step;
+                    for (size_t bx = 0; bx < view.decimation; bx++)
+                    {
+                        const uint16_t d = loadDepth16(p + bx * sizeof(uint16_t), swapBytes);
+                        if (d != 0 && (depth == 0 || d < depth))
+                        {
+                            depth = d;
+                        }
+                    }
+                }
+            }
+            out[c] = static_cast<float>(depth) * scale;
+        }
+    }
+}
+
+// Copies float depth samples (metres). NaN, infinite and non positive samples are invalid measurements.
+void copyDepthFloatRows(const RosImageView& view, DepthImage& dest, bool minPooling)
+{
+    if (view.decimation == 1 || !minPooling)
+    {
+        copyRows(view, dest);
+        return;
+    }
+    const size_t pixelStride = view.decimation * sizeof(float);
+    for (size_t r = 0; r < view.height; r++)
+    {
+        const unsigned char* src = view.row(r);
+        float* out = reinterpret_cast<float*>(dest.getRow(r));
+        for (size_t c = 0; c < view.width; c++)
+        {
+            const unsigned char* block = src + c * pixelStride;
+            float depth = loadDepthFloat(block);
+            bool valid = std::isfinite(depth) && depth > 0;
+            for (size_t by = 0; by < view.decimation; by++)
+            {
+                const unsigned char* p = block + by * view.step;
+                for (size_t bx = 0; bx < view.decimation; bx++)
+                {
+                    const float d = loadDepthFloat(p + bx * sizeof(float));
+                    if (std::isfinite(d) && d > 0 && (!valid || d < depth))
+                    {
+                        depth = d;
+                        valid = true;
+                    }
+                }
+            }
+            out[c] = depth;
+        }
+    }
+}
+
+bool isBayer8(int pixcode, BayerPattern& pattern)
+{
+    switch (pixcode)
+    {
+    case VOCAB_PIXEL_ENCODING_BAYER_RGGB8: pattern = BayerPattern::RGGB; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_BGGR8: pattern = BayerPattern::BGGR; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_GRBG8: pattern = BayerPattern::GRBG; return true;
+    case VOCAB_PIXEL_ENCODING_BAYER_GBRG8: pattern = BayerPattern::GBRG; return true;
+    default: return false;
+    }
+}
+}
+
+bool IngestWindow::isIdentity() const
+{
+    return x == 0 && y == 0 && width == 0 && height == 0 && decimation <= 1;
+}
+
+bool IngestWindow::resolve(size_t sourceWidth, size_t sourceHeight, size_t& x0, size_t& y0, size_t& outWidth, size_t& outHeight) const
+{
+    if (x >= sourceWidth || y >= sourceHeight)
+    {
+        return false;
+    }
+    x0 = x;
+    y0 = y;
+    const size_t roiWidth = (width == 0) ? sourceWidth - x : std::min(width, sourceWidth - x);
+    const size_t roiHeight = (height == 0) ? sourceHeight - y : std::min(height, sourceHeight - y);
+    const size_t d = std::max<size_t>(decimation, 1);
+    outWidth = roiWidth / d;
+    outHeight = roiHeight / d;
+    return outWidth > 0 && outHeight > 0;
 }
 
 commonImageProcessor::commonImageProcessor(std::string cameradata_topic_name, std::string camerainfo_topic_name)
@@ -31,161 +281,575 @@ commonImageProcessor::commonImageProcessor(std::string cameradata_topic_name, st
     {
         yCError(RGBD_ROS) << "Error opening topic:" << cameradata_topic_name;
     }
-    if (m_subscriber_camera_info.topic(camerainfo_topic_name) == false)
+    if (m_camera_info_processor.topic(camerainfo_topic_name) == false)
     {
         yCError(RGBD_ROS) << "Error opening topic:" << camerainfo_topic_name;
     }
+    m_camera_info_processor.useCallback();
     m_cameradata_topic_name = cameradata_topic_name;
     m_camerainfo_topic_name = camerainfo_topic_name;
-    m_contains_rgb_data = false;
-    m_contains_depth_data = false;
+    m_depth_scale = DEFAULT_DEPTH_SCALE;
 }
 commonImageProcessor::~commonImageProcessor()
 {
     this->close();
-    m_subscriber_camera_info.close();
+    m_camera_info_processor.close();
 }
 
 bool commonImageProcessor::getLastRGBData(yarp::sig::FlexImage& data, yarp::os::Stamp& stmp)
 {
-    if (m_contains_rgb_data == false) { return false;}
-
-    //this blocks untils the first data is received;
-    /*size_t counter = 0;
-    while (m_contains_rgb_data == false)
-    {
-        yarp::os::Time::delay(0.1);
-        if (counter++ > 100) { yCDebug(RGBD_ROS) << "Waiting for incoming rgb data..."; counter = 0; }
-    }*/
+    // the frame stays alive (and untouched by onRead) as long as we hold a reference to it
+    auto frame = m_rgbFrames.latest();
+    if (!frame) { return false; }
 
-    m_port_mutex.lock();
-    data = m_lastRGBImage;
-    //stmp = m_lastStamp;    ///@@@<-SEGFAULT
-    m_port_mutex.unlock();
+    m_unread.store(false, std::memory_order_relaxed);
+    data = frame->image;
+    stmp = frame->stamp;
     return true;
 }
 
 bool commonImageProcessor::getLastDepthData(yarp::sig::ImageOf<yarp::sig::PixelFloat>& data, yarp::os::Stamp& stmp)
 {
-    if (m_contains_depth_data == false) { return false;}
+    auto frame = m_depthFrames.latest();
+    if (!frame) { return false; }
+
+    m_unread.store(false, std::memory_order_relaxed);
+    data = frame->image;
+    stmp = frame->stamp;
+    return true;
+}
+
+void commonImageProcessor::setDepthScale(double scale)
+{
+    m_depth_scale = scale;
+}
+
+void commonImageProcessor::setColorFormat(int pixelCode)
+{
+    m_color_format = pixelCode;
+}
+
+void commonImageProcessor::setIngestWindow(const IngestWindow& window)
+{
+    m_window = window;
+    m_camera_info_processor.setIngestWindow(window);
+}
+
+void commonImageProcessor::setDepthPostProcess(DepthPostProcess process)
+{
+    m_depth_postprocess = std::move(process);
+}
+
+void commonImageProcessor::setHistoryDepth(size_t depth)
+{
+    m_rgbFrames.setHistoryDepth(depth);
+    m_depthFrames.setHistoryDepth(depth);
+}
 
-    //this blocks untils the first data is received;
-    /*size_t counter = 0;
-    while (m_contains_depth_data == false)
+std::vector<std::shared_ptr<const StampedImage<yarp::sig::FlexImage>>> commonImageProcessor::getRGBHistory() const
+{
+    m_unread.store(false, std::memory_order_relaxed);
+    return m_rgbFrames.history();
+}
+
+std::vector<std::shared_ptr<const StampedImage<DepthImage>>> commonImageProcessor::getDepthHistory() const
+{
+    m_unread.store(false, std::memory_order_relaxed);
+    return m_depthFrames.history();
+}
+
+int commonImageProcessor::resolvePixelCode(const std::string& encoding)
+{
+    // the encoding of a stream practically never changes: look it up only when it does
+    if (encoding != m_cached_encoding)
     {
-        yarp::os::Time::delay(0.1);
-        if (counter++ > 100) { yCDebug(RGBD_ROS) << "Waiting for incoming depth data..."; counter = 0; }
-    }*/
+        m_cached_encoding = encoding;
+        m_cached_pixcode = yarp::dev::ROSPixelCode::Ros2YarpPixelCode(encoding);
+        m_encoding_reported = false;
+    }
+    return m_cached_pixcode;
+}
 
-    m_port_mutex.lock();
-    data = m_lastDepthImage;
-    //stmp = m_lastStamp;    ///@@@<-SEGFAULT
-    m_port_mutex.unlock();
-    return true;
+void commonImageProcessor::notifyFrame(const yarp::os::Stamp& stamp)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_frame_mutex);
+        m_published_count = stamp.getCount();
+    }
+    m_frame_cv.notify_all();
+}
+
+void commonImageProcessor::frameReady(const yarp::os::Stamp& stamp, double receiveTime)
+{
+    m_statistics.conversionTime.add(yarp::os::Time::now() - receiveTime);
+    if (m_unread.exchange(true, std::memory_order_relaxed))
+    {
+        m_statistics.overwrittenUnread++;
+    }
+    notifyFrame(stamp);
+}
+
+const IngestStatistics& commonImageProcessor::getStatistics() const
+{
+    return m_statistics;
+}
+
+void commonImageProcessor::resetStatistics()
+{
+    m_statistics.reset();
+}
+
+bool commonImageProcessor::waitForFrame(int lastCount, double timeout)
+{
+    std::unique_lock<std::mutex> lock(m_frame_mutex);
+    const bool ready = m_frame_cv.wait_for(lock,
+                                           std::chrono::duration<double>(timeout),
+                                           [&]() { return m_waits_interrupted || m_published_count != lastCount; });
+    return ready && !m_waits_interrupted;
+}
+
+int commonImageProcessor::getPublishedCount()
+{
+    std::lock_guard<std::mutex> lock(m_frame_mutex);
+    return m_published_count;
+}
+
+void commonImageProcessor::interruptWaits()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_frame_mutex);
+        m_waits_interrupted = true;
+    }
+    m_frame_cv.notify_all();
+}
+
+yarp::os::Stamp commonImageProcessor::nextStamp(const yarp::rosmsg::sensor_msgs::Image& v)
+{
+    m_lastStamp.update();
+    if (v.header.stamp.sec != 0 || v.header.stamp.nsec != 0)
+    {
+        m_lastStamp = yarp::os::Stamp(m_lastStamp.getCount(), v.header.stamp.sec + v.header.stamp.nsec * 1e-9);
+    }
+    return m_lastStamp;
 }
 
 size_t commonImageProcessor::getWidth() const
 {
-   return m_lastDepthImage.width();
+    if (auto rgb = m_rgbFrames.latest()) { return rgb->image.width(); }
+    if (auto depth = m_depthFrames.latest()) { return depth->image.width(); }
+    return 0;
 }
 
 size_t commonImageProcessor::getHeight() const
 {
-    return m_lastDepthImage.height();
+    if (auto rgb = m_rgbFrames.latest()) { return rgb->image.height(); }
+    if (auto depth = m_depthFrames.latest()) { return depth->image.height(); }
+    return 0;
 }
 
 void commonImageProcessor::onRead(yarp::rosmsg::sensor_msgs::Image& v)
 {
-    m_port_mutex.lock();
-    int yarp_pixcode = yarp::dev::ROSPixelCode::Ros2YarpPixelCode(v.encoding);
-    if (yarp_pixcode == VOCAB_PIXEL_RGB ||
-        yarp_pixcode == VOCAB_PIXEL_BGR)
+    const double receive_time = yarp::os::Time::now();
+    m_statistics.onReceived(v.header.stamp.sec + v.header.stamp.nsec * 1e-9, receive_time);
+
+    int yarp_pixcode = resolvePixelCode(v.encoding);
+    BayerPattern bayer_pattern = BayerPattern::RGGB;
+    const bool bayer = isBayer8(yarp_pixcode, bayer_pattern);
+    const bool color = yarp_pixcode == VOCAB_PIXEL_RGB ||
+                       yarp_pixcode == VOCAB_PIXEL_BGR ||
+                       yarp_pixcode == VOCAB_PIXEL_RGBA ||
+                       yarp_pixcode == VOCAB_PIXEL_BGRA ||
+                       bayer;
+    const bool depth = yarp_pixcode == VOCAB_PIXEL_MONO16 ||
+                       yarp_pixcode == VOCAB_PIXEL_MONO_FLOAT;
+    if (!color && !depth)
     {
-        m_lastRGBImage.setPixelCode(yarp_pixcode);
-        m_lastRGBImage.resize(v.width, v.height);
-        size_t c = 0;
-        for (auto it = v.data.begin(); it != v.data.end(); it++)
+        if (!m_encoding_reported)
+        {
+            yCError(RGBD_ROS) << "Unsupported rgb/depth format:" << v.encoding << "on topic" << m_cameradata_topic_name;
+            m_encoding_reported = true;
+        }
+        m_statistics.rejected++;
+        return;
+    }
+
+    size_t pixelSize = 4;
+    if (bayer) { pixelSize = 1; }
+    else if (yarp_pixcode == VOCAB_PIXEL_RGB || yarp_pixcode == VOCAB_PIXEL_BGR) { pixelSize = 3; }
+    else if (yarp_pixcode == VOCAB_PIXEL_MONO16) { pixelSize = sizeof(uint16_t); }
+    if (!checkRosImageLayout(v, pixelSize))
+    {
+        m_statistics.rejected++;
+        return;
+    }
+
+    // only the ingest window is converted (the whole image by default)
+    size_t x0 = 0;
+    size_t y0 = 0;
+    size_t width = 0;
+    size_t height = 0;
+    if (!m_window.resolve(v.width, v.height, x0, y0, width, height))
+    {
+        if (!m_window_reported)
+        {
+            yCError(RGBD_ROS) << "The ingest window is outside the" << v.width << "x" << v.height << "images received on" << m_cameradata_topic_name;
+            m_window_reported = true;
+        }
+        m_statistics.rejected++;
+        return;
+    }
+    const RosImageView view = makeView(v, pixelSize, x0, y0, width, height, m_window.decimation);
+
+    if (color)
+    {
+        int out_pixcode = m_color_format;
+        if (out_pixcode == 0)
+        {
+            out_pixcode = bayer ? VOCAB_PIXEL_RGB : yarp_pixcode;
+        }
+        // same channel order of the requested format (RGB/RGBA or BGR/BGRA)?
+        const bool same_order = (yarp_pixcode == VOCAB_PIXEL_RGB || yarp_pixcode == VOCAB_PIXEL_RGBA) == (out_pixcode == VOCAB_PIXEL_RGB);
+
+        auto frame = m_rgbFrames.acquire();
+        frame->image.setPixelCode(out_pixcode);
+        frame->image.resize(width, height);
+        if (out_pixcode == yarp_pixcode)
+        {
+            copyRows(view, frame->image);
+        }
+        else if (bayer)
+        {
+            const BayerPattern pattern = bayerPatternAt(bayer_pattern, x0, y0);
+            if (view.decimation == 1)
+            {
+                demosaicBayer8(view.data, view.step, frame->image.getRawImage(), frame->image.getRowSize(),
+                               width, height, pattern, out_pixcode == VOCAB_PIXEL_BGR);
+            }
+            else
+            {
+                m_camera_info_processor.setBayerBinning(true);
+                binBayer8(view.data, view.step, frame->image.getRawImage(), frame->image.getRowSize(),
+                          width, height, view.decimation, pattern, out_pixcode == VOCAB_PIXEL_BGR);
+            }
+        }
+        else if (pixelSize == 3)
         {
-            m_lastRGBImage.getRawImage()[c++]=*it;
+            convertRows(view, frame->image, convertBgrToRgb, m_row_buffer);
         }
-        m_lastStamp.update();
-        m_contains_rgb_data = true;
+        else
+        {
+            convertRows(view, frame->image, same_order ? convertRgbaToRgb : convertBgraToRgb, m_row_buffer);
+        }
+        frame->stamp = nextStamp(v);
+        m_rgbFrames.publish(frame);
+        frameReady(frame->stamp, receive_time);
     }
-    else if (v.encoding == TYPE_16UC1)
+    else
     {
-        m_lastDepthImage.resize(v.width, v.height);
-        size_t c = 0;
-        uint16_t* p = (uint16_t*)(v.data.data());
-        uint16_t* siz = (uint16_t*)(v.data.data()) + (v.data.size() / sizeof(uint16_t));
-        int count = 0;
-        for (; p < siz; p++)
+        auto frame = m_depthFrames.acquire();
+        // with a post-processing stage the frame is filled by it, from the converted depth
+        DepthImage& depth = m_depth_postprocess ? m_raw_depth : frame->image;
+        depth.resize(width, height);
+        if (yarp_pixcode == VOCAB_PIXEL_MONO16)
+        {
+            const bool swapBytes = (v.is_bigendian != 0) != hostIsBigEndian();
+            convertDepth16Rows(view, depth, static_cast<float>(m_depth_scale), swapBytes, m_window.minDepthPooling);
+        }
+        else
         {
-            float value = float(*p) / 1000.0;
-            ((float*)(m_lastDepthImage.getRawImage()))[c++] = value;
-            count++;
+            copyDepthFloatRows(view, depth, m_window.minDepthPooling);
         }
-        m_lastStamp.update();
-        m_contains_depth_data = true;
+        if (m_depth_postprocess && !m_depth_postprocess(m_raw_depth, frame->image))
+        {
+            m_statistics.rejected++;
+            return;
+        }
+        frame->stamp = nextStamp(v);
+        m_depthFrames.publish(frame);
+        frameReady(frame->stamp, receive_time);
     }
-    else if (v.encoding == TYPE_32FC1)
+}
+
+void cameraInfoProcessor::onRead(yarp::rosmsg::sensor_msgs::CameraInfo& v)
+{
+    // the decimated pixel c stands for the ROI pixel c * decimation + sample_offset: the top left sample of
+    // its block with nearest decimation, the centre of the block with min pooling, the centre of the 2x2
+    // cell at even coordinates with Bayer binning (for odd decimations the cells alternate between
+    // c * decimation - 1 and c * decimation, 0 being their mean offset)
+    const size_t d = std::max<size_t>(m_window.decimation, 1);
+    double sample_offset = 0;
+    if (m_window.minDepthPooling)
+    {
+        sample_offset = static_cast<double>(d - 1) / 2.0;
+    }
+    else if (m_bayer_binning.load(std::memory_order_relaxed) && d % 2 == 0)
+    {
+        sample_offset = 0.5;
+    }
+
+    // camera_info is usually published at the frame rate but almost never changes:
+    // parse it only when its content differs from the cached one
+    auto current = std::atomic_load(&m_intrinsics);
+    if (current &&
+        current->sampleOffset == sample_offset &&
+        current->sourceWidth == v.width &&
+        current->sourceHeight == v.height &&
+        current->distortionModel == v.distortion_model &&
+        current->D == v.D &&
+        current->K == v.K)
     {
-        m_lastDepthImage.resize(v.width, v.height);
-        size_t c = 0;
-        for (auto it = v.data.begin(); it != v.data.end(); it++)
+        return;
+    }
+
+    if (v.K.size() < 9)
+    {
+        // never cached, so it would be reported at every message
+        if (!m_invalid_reported)
         {
-            m_lastDepthImage.getRawImage()[c++] = *it;
+            yCError(RGBD_ROS) << "Invalid camera_info: K has" << v.K.size() << "elements";
+            m_invalid_reported = true;
         }
-        m_lastStamp.update();
-        m_contains_depth_data = true;
+        return;
+    }
+    m_invalid_reported = false;
+
+    auto intrinsics = std::make_shared<CameraIntrinsics>();
+    intrinsics->sourceWidth = v.width;
+    intrinsics->sourceHeight = v.height;
+    size_t x0 = 0;
+    size_t y0 = 0;
+    if (!m_window.resolve(v.width, v.height, x0, y0, intrinsics->width, intrinsics->height) && !m_window.isIdentity())
+    {
+        yCError(RGBD_ROS) << "The ingest window is outside the" << v.width << "x" << v.height << "images described by camera_info";
+    }
+    intrinsics->distortionModel = v.distortion_model;
+    intrinsics->D = v.D;
+    intrinsics->K = v.K;
+    intrinsics->sampleOffset = sample_offset;
+    intrinsics->version = current ? current->version + 1 : 1;
+
+    yarp::sig::IntrinsicParams& params = intrinsics->params;
+    const double decimation = static_cast<double>(d);
+    params.focalLengthX = v.K[0] / decimation;
+    params.focalLengthY = v.K[4] / decimation;
+    params.principalPointX = (v.K[2] - static_cast<double>(m_window.x) - sample_offset) / decimation;
+    params.principalPointY = (v.K[5] - static_cast<double>(m_window.y) - sample_offset) / decimation;
+    // distortion model
+    if (v.distortion_model == "plumb_bob" && v.D.size() >= 5)
+    {
+        params.distortionModel.type = YarpDistortion::YARP_PLUMB_BOB;
+        params.distortionModel.k1 = v.D[0];
+        params.distortionModel.k2 = v.D[1];
+        params.distortionModel.t1 = v.D[2];
+        params.distortionModel.t2 = v.D[3];
+        params.distortionModel.k3 = v.D[4];
     }
     else
     {
-        yCError(RGBD_ROS) << "Unsupported rgb/depth format:" << v.encoding;
+        yCError(RGBD_ROS) << "Unsupported distortion model" << v.distortion_model;
     }
-    m_port_mutex.unlock();
+
+    std::atomic_store(&m_intrinsics, std::shared_ptr<const CameraIntrinsics>(std::move(intrinsics)));
+}
+
+void cameraInfoProcessor::setIngestWindow(const IngestWindow& window)
+{
+    m_window = window;
+}
+
+void cameraInfoProcessor::setBayerBinning(bool binning)
+{
+    m_bayer_binning.store(binning, std::memory_order_relaxed);
+}
+
+std::shared_ptr<const CameraIntrinsics> cameraInfoProcessor::getIntrinsics() const
+{
+    return std::atomic_load(&m_intrinsics);
+}
+
+std::shared_ptr<const CameraIntrinsics> commonImageProcessor::getIntrinsics() const
+{
+    return m_camera_info_processor.getIntrinsics();
+}
+
+size_t commonImageProcessor::getIntrinsicsVersion() const
+{
+    auto intrinsics = m_camera_info_processor.getIntrinsics();
+    return intrinsics ? intrinsics->version : 0;
 }
 
 bool commonImageProcessor::getFOV(double& horizontalFov, double& verticalFov) const
 {
-    yarp::rosmsg::sensor_msgs::CameraInfo* tmp = m_subscriber_camera_info.read(true);
-    m_lastCameraInfo = *tmp;
-    yarp::sig::IntrinsicParams params;
-    params.focalLengthX = m_lastCameraInfo.K[0];
-    params.focalLengthY = m_lastCameraInfo.K[4];
-    params.principalPointX = m_lastCameraInfo.K[2];
-    params.principalPointY = m_lastCameraInfo.K[5];
-    yCError(RGBD_ROS) << "getIntrinsicParam not yet implemented";
-    return false;
+    auto intrinsics = m_camera_info_processor.getIntrinsics();
+    if (!intrinsics ||
+        intrinsics->params.focalLengthX <= 0 ||
+        intrinsics->params.focalLengthY <= 0)
+    {
+        yCError(RGBD_ROS) << "No valid camera_info received yet on" << m_camerainfo_topic_name;
+        return false;
+    }
+    // YARP expresses the field of view in degrees
+    constexpr double rad2deg = 180.0 / 3.14159265358979323846;
+    horizontalFov = 2.0 * atan(intrinsics->width / (2.0 * intrinsics->params.focalLengthX)) * rad2deg;
+    verticalFov = 2.0 * atan(intrinsics->height / (2.0 * intrinsics->params.focalLengthY)) * rad2deg;
+    return true;
 }
 
 bool commonImageProcessor::getIntrinsicParam(yarp::os::Property& intrinsic) const
 {
-    yarp::rosmsg::sensor_msgs::CameraInfo* tmp = m_subscriber_camera_info.read(true);
-    m_lastCameraInfo = *tmp;
     intrinsic.clear();
-    yarp::sig::IntrinsicParams params;
-    params.focalLengthX = m_lastCameraInfo.K[0];
-    params.focalLengthY = m_lastCameraInfo.K[4];
-    params.principalPointX = m_lastCameraInfo.K[2];
-    params.principalPointY = m_lastCameraInfo.K[5];
-    // distortion model
-    if (m_lastCameraInfo.distortion_model=="plumb_bob")
+    auto intrinsics = m_camera_info_processor.getIntrinsics();
+    if (!intrinsics)
     {
-        params.distortionModel.type = YarpDistortion::YARP_PLUMB_BOB;
-        params.distortionModel.k1 = m_lastCameraInfo.D[0];
-        params.distortionModel.k2 = m_lastCameraInfo.D[1];
-        params.distortionModel.t1 = m_lastCameraInfo.D[2];
-        params.distortionModel.t2 = m_lastCameraInfo.D[3];
-        params.distortionModel.k3 = m_lastCameraInfo.D[4];
+        yCError(RGBD_ROS) << "No camera_info received yet on" << m_camerainfo_topic_name;
+        return false;
     }
-    else
+    intrinsics->params.toProperty(intrinsic);
+    return true;
+}
+
+
+bool yarp::dev::RGBDRosConversionUtils::resampleColor(const yarp::sig::FlexImage& src, const IngestWindow& window, yarp::sig::FlexImage& dest)
+{
+    size_t x0 = 0;
+    size_t y0 = 0;
+    size_t width = 0;
+    size_t height = 0;
+    if (!window.resolve(src.width(), src.height(), x0, y0, width, height))
+    {
+        return false;
+    }
+    const size_t d = std::max<size_t>(window.decimation, 1);
+    const size_t pixelSize = src.getPixelSize();
+    switch (src.getPixelCode())
+    {
+    case VOCAB_PIXEL_MONO:
+    case VOCAB_PIXEL_RGB:
+    case VOCAB_PIXEL_BGR:
+    case VOCAB_PIXEL_RGBA:
+    case VOCAB_PIXEL_BGRA:
+        break;
+    default:
+        if (d > 1)
+        {
+            return false;
+        }
+    }
+
+    dest.setPixelCode(src.getPixelCode());
+    dest.resize(width, height);
+    if (d == 1)
     {
-        yCError(RGBD_ROS) << "Unsupported distortion model";
+        for (size_t r = 0; r < height; r++)
+        {
+            memcpy(dest.getRow(r), src.getRow(y0 + r) + x0 * pixelSize, width * pixelSize);
+        }
+        return true;
+    }
+
+    // every channel of an output pixel is the rounded mean of the d x d block
+    const size_t channels = width * pixelSize;
+    const uint32_t count = static_cast<uint32_t>(d * d);
+    std::vector<uint32_t> sums(channels);
+    for (size_t r = 0; r < height; r++)
+    {
+        std::fill(sums.begin(), sums.end(), 0);
+        for (size_t by = 0; by < d; by++)
+        {
+            const unsigned char* in = src.getRow(y0 + r * d + by) + x0 * pixelSize;
+            for (size_t c = 0; c < width; c++)
+            {
+                uint32_t* sum = sums.data() + c * pixelSize;
+                for (size_t bx = 0; bx < d; bx++)
+                {
+                    for (size_t k = 0; k < pixelSize; k++)
+                    {
+                        sum[k] += *in++;
+                    }
+                }
+            }
+        }
+        unsigned char* out = dest.getRow(r);
+        for (size_t i = 0; i < channels; i++)
+        {
+            out[i] = static_cast<unsigned char>((sums[i] + count / 2) / count);
+        }
+    }
+    return true;
+}
+
+bool yarp::dev::RGBDRosConversionUtils::resampleDepth(const DepthImage& src, const IngestWindow& window, DepthImage& dest)
+{
+    size_t x0 = 0;
+    size_t y0 = 0;
+    size_t width = 0;
+    size_t height = 0;
+    if (!window.resolve(src.width(), src.height(), x0, y0, width, height))
+    {
+        return false;
+    }
+    const size_t d = std::max<size_t>(window.decimation, 1);
+
+    dest.resize(width, height);
+    for (size_t r = 0; r < height; r++)
+    {
+        const float* in = reinterpret_cast<const float*>(src.getRow(y0 + r * d)) + x0;
+        float* out = reinterpret_cast<float*>(dest.getRow(r));
+        if (d == 1)
+        {
+            memcpy(out, in, width * sizeof(float));
+            continue;
+        }
+        for (size_t c = 0; c < width; c++)
+        {
+            float depth = in[c * d];
+            if (window.minDepthPooling)
+            {
+                // NaN, infinite and non positive samples are invalid measurements
+                bool valid = std::isfinite(depth) && depth > 0;
+                for (size_t by = 0; by < d; by++)
+                {
+                    const float* block = reinterpret_cast<const float*>(src.getRow(y0 + r * d + by)) + x0 + c * d;
+                    for (size_t bx = 0; bx < d; bx++)
+                    {
+                        if (std::isfinite(block[bx]) && block[bx] > 0 && (!valid || block[bx] < depth))
+                        {
+                            depth = block[bx];
+                            valid = true;
+                        }
+                    }
+                }
+            }
+            out[c] = depth;
+        }
+    }
+    return true;
+}
+
+void yarp::dev::RGBDRosConversionUtils::depthToMillimetres(const DepthImage& src, yarp::sig::ImageOf<yarp::sig::PixelMono16>& dest)
+{
+    dest.resize(src.width(), src.height());
+    for (size_t r = 0; r < src.height(); r++) {
+        convertFloatDepthTo16U(reinterpret_cast<const float*>(src.getRow(r)),
+                               reinterpret_cast<std::uint16_t*>(dest.getRow(r)),
+                               src.width(),
+                               static_cast<float>(1.0 / DEFAULT_DEPTH_SCALE));
     }
-    params.toProperty(intrinsic);
-    return true;    ///@@@<-was false???
 }
 
+void yarp::dev::RGBDRosConversionUtils::shallowCopyImages(const yarp::sig::Image& src,
+    ImageWire& dest,
+    const std::string& frame_id,
+    const yarp::rosmsg::TickTime& timeStamp,
+    const unsigned int& seq)
+{
+    dest.setImage(src);
+    dest.encoding = yarp::dev::ROSPixelCode::yarp2RosPixelCode(src.getPixelCode());
+    dest.header.frame_id = frame_id;
+    dest.header.stamp = timeStamp;
+    dest.header.seq = seq;
+    dest.is_bigendian = 0;
+}
 
 void yarp::dev::RGBDRosConversionUtils::shallowCopyImages(const yarp::sig::FlexImage& src, yarp::sig::FlexImage& dest)
 {
@@ -8,7 +8,13 @@
 
 #include <iostream>
 #include <cstring>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <yarp/os/PeriodicThread.h>
 #include <yarp/sig/all.h>
@@ -23,26 +29,148 @@
 
 #include <yarp/rosmsg/impl/yarpRosHelper.h>
 
+#include "frameHandoff.h"
+#include "ingestStatistics.h"
+#include "rosImageWire.h"
+
 typedef yarp::sig::ImageOf<yarp::sig::PixelFloat> DepthImage;
 
 namespace yarp::dev::RGBDRosConversionUtils {
 
+/**
+ * An image together with its stamp.
+ * The stamp time is the acquisition time found in the ROS message header (or the reception
+ * time if the publisher left it empty), the stamp count is incremented for every received frame.
+ */
+template <typename ImageT>
+struct StampedImage
+{
+    ImageT          image;
+    yarp::os::Stamp stamp;
+};
+
+/**
+ * Region of the received images that is converted, and the integer decimation applied to it.
+ * Only the reduced image is allocated and filled: the decimated pixel (c, r) is the ROI pixel
+ * (c * decimation, r * decimation), or the closest valid depth sample of the decimation x decimation
+ * block starting there if minDepthPooling is set (the block top-left sample if none is valid).
+ */
+struct IngestWindow
+{
+    size_t x = 0;
+    size_t y = 0;
+    size_t width = 0;      ///< 0 means up to the right image border
+    size_t height = 0;     ///< 0 means up to the bottom image border
+    size_t decimation = 1;
+    bool   minDepthPooling = false;
+
+    bool isIdentity() const;
+
+    /**
+     * Clips the window to a `sourceWidth` x `sourceHeight` image, returning the ROI origin and the
+     * size of the output image. Returns false if the output image is empty.
+     */
+    bool resolve(size_t sourceWidth, size_t sourceHeight, size_t& x0, size_t& y0, size_t& outWidth, size_t& outHeight) const;
+};
+
+/**
+ * Immutable snapshot of the intrinsics carried by a CameraInfo message.
+ * A new snapshot (with an increased version) is created only when the message content changes.
+ * `D` and `K` are the received ones, while `params`, `width` and `height` describe the images delivered
+ * after the ingest window (see IngestWindow) is applied.
+ */
+struct CameraIntrinsics
+{
+    yarp::sig::IntrinsicParams params;
+    size_t                     width = 0;
+    size_t                     height = 0;
+    size_t                     sourceWidth = 0;
+    size_t                     sourceHeight = 0;
+    std::string                distortionModel;
+    std::vector<double>        D;
+    std::vector<double>        K;
+    double                     sampleOffset = 0;  ///< source pixels from the top left corner of a decimation block to the point its output pixel stands for
+    size_t                     version = 0;
+};
+
+class cameraInfoProcessor:
+    public yarp::os::Subscriber<yarp::rosmsg::sensor_msgs::CameraInfo>
+{
+    protected:
+    std::shared_ptr<const CameraIntrinsics> m_intrinsics;
+    IngestWindow                            m_window;
+    std::atomic<bool>                       m_bayer_binning {false};
+    bool                                    m_invalid_reported = false;
+
+    public:
+    using yarp::os::Subscriber<yarp::rosmsg::sensor_msgs::CameraInfo>::onRead;
+    virtual void onRead(yarp::rosmsg::sensor_msgs::CameraInfo& v) override;
+
+    /**
+     * Sets the ingest window the intrinsics are adapted to. Must be called before the callback is enabled.
+     */
+    void setIngestWindow(const IngestWindow& window);
+
+    /**
+     * Tells that the images are Bayer ones binned 2x2 by the decimation (see binBayer8()): from the next
+     * camera_info on, the principal point is referred to the centre of the binned cells.
+     */
+    void setBayerBinning(bool binning);
+
+    /**
+     * Returns the last received intrinsics, or nullptr if no camera_info was received yet.
+     * It never blocks.
+     */
+    std::shared_ptr<const CameraIntrinsics> getIntrinsics() const;
+};
+
+/**
+ * Processing applied to every depth frame after the conversion and before it is made available:
+ * it fills `output` from `depth` and returns false to drop the frame.
+ */
+typedef std::function<bool(const DepthImage& depth, DepthImage& output)> DepthPostProcess;
+
 class commonImageProcessor:
     public yarp::os::Subscriber<yarp::rosmsg::sensor_msgs::Image>
 {
     protected:
-    yarp::sig::FlexImage   m_lastRGBImage;
-    DepthImage             m_lastDepthImage;
+    FrameHandoff<StampedImage<yarp::sig::FlexImage>> m_rgbFrames;
+    FrameHandoff<StampedImage<DepthImage>>           m_depthFrames;
 
     protected:
-    std::mutex             m_port_mutex;
-    mutable yarp::os::Subscriber   <yarp::rosmsg::sensor_msgs::CameraInfo> m_subscriber_camera_info;
+    cameraInfoProcessor    m_camera_info_processor;
     std::string            m_cameradata_topic_name;
     std::string            m_camerainfo_topic_name;
-    mutable yarp::rosmsg::sensor_msgs::CameraInfo m_lastCameraInfo;
     yarp::os::Stamp        m_lastStamp;
-    bool                   m_contains_rgb_data;
-    bool                   m_contains_depth_data;
+    double                 m_depth_scale;
+    int                    m_color_format = 0;
+    IngestWindow           m_window;
+    std::vector<unsigned char> m_row_buffer;
+    bool                   m_window_reported = false;
+
+    // statistics, m_unread is set when a frame is published and cleared when it is read
+    IngestStatistics       m_statistics;
+    mutable std::atomic<bool> m_unread {false};
+
+    // optional depth post-processing, applied to m_raw_depth
+    DepthPostProcess       m_depth_postprocess;
+    DepthImage             m_raw_depth;
+
+    // new frame notification
+    std::mutex             m_frame_mutex;
+    std::condition_variable m_frame_cv;
+    int                    m_published_count = -1;
+    bool                   m_waits_interrupted = false;
+
+    // pixel code of the last received encoding
+    std::string            m_cached_encoding;
+    int                    m_cached_pixcode = 0;
+    bool                   m_encoding_reported = false;
+
+    int resolvePixelCode(const std::string& encoding);
+    yarp::os::Stamp nextStamp(const yarp::rosmsg::sensor_msgs::Image& v);
+    void notifyFrame(const yarp::os::Stamp& stamp);
+    void frameReady(const yarp::os::Stamp& stamp, double receiveTime);
 
     public:
     commonImageProcessor (std::string data_topic_name, std::string camera_info_topic_name);
@@ -50,15 +178,80 @@ class commonImageProcessor:
     using yarp::os::Subscriber<yarp::rosmsg::sensor_msgs::Image>::onRead;
     virtual void onRead(yarp::rosmsg::sensor_msgs::Image& v) override;
 
+    public:
+    /**
+     * Sets the factor used to convert 16 bit depth samples to metres (0.001 for millimetre depth).
+     */
+    void setDepthScale(double scale);
+
+    /**
+     * Sets the pixel code (`VOCAB_PIXEL_RGB` or `VOCAB_PIXEL_BGR`) every color frame is converted to.
+     * With 0 (the default) the frames keep the received pixel format, except Bayer images that are
+     * demosaiced to RGB.
+     */
+    void setColorFormat(int pixelCode);
+
+    /**
+     * Converts only a region of the received images, optionally decimated (see IngestWindow).
+     * The intrinsics returned by getIntrinsicParam()/getFOV() refer to the reduced images.
+     * Must be called before the callback is enabled.
+     */
+    void setIngestWindow(const IngestWindow& window);
+
+    /**
+     * Runs `process` on every depth frame, on the thread receiving the frames: its output is the frame
+     * returned by getLastDepthData(). Must be called before the callback is enabled.
+     */
+    void setDepthPostProcess(DepthPostProcess process);
+
+    /**
+     * Keeps the last `depth` frames of each stream available through getRGBHistory()/getDepthHistory().
+     * Must be called before the callback is enabled.
+     */
+    void setHistoryDepth(size_t depth);
+
     public:
     size_t getWidth() const;
     size_t getHeight() const;
     bool getFOV(double& horizontalFov, double& verticalFov) const;
     bool getIntrinsicParam(yarp::os::Property& intrinsic) const;
+    std::shared_ptr<const CameraIntrinsics> getIntrinsics() const;
+
+    /**
+     * Returns a number that changes every time the camera_info content changes (0 until the first one is received).
+     */
+    size_t getIntrinsicsVersion() const;
 
     public:
     bool getLastRGBData(yarp::sig::FlexImage& data, yarp::os::Stamp& stmp);
     bool getLastDepthData(yarp::sig::ImageOf<yarp::sig::PixelFloat>& data, yarp::os::Stamp& stmp);
+
+    /**
+     * Blocks until a frame whose stamp count differs from `lastCount` (i.e. a frame newer than the one
+     * with that count, -1 if none was seen) has been received, or until `timeout` seconds have elapsed.
+     * @return true if such a frame is available
+     */
+    bool waitForFrame(int lastCount, double timeout);
+
+    /**
+     * Stamp count of the newest frame received (-1 if none).
+     */
+    int getPublishedCount();
+
+    /**
+     * Wakes up the threads blocked in waitForFrame(), and makes the next calls return false immediately
+     * (e.g. before the processor is deleted).
+     */
+    void interruptWaits();
+    std::vector<std::shared_ptr<const StampedImage<yarp::sig::FlexImage>>> getRGBHistory() const;
+    std::vector<std::shared_ptr<const StampedImage<DepthImage>>> getDepthHistory() const;
+
+    public:
+    /**
+     * Statistics of the received stream. They can be read (and reset) while frames are being received.
+     */
+    const IngestStatistics& getStatistics() const;
+    void resetStatistics();
 };
 
 void deepCopyImages(const yarp::sig::FlexImage& src,
@@ -73,6 +266,34 @@ void deepCopyImages(const DepthImage& src,
     const yarp::rosmsg::TickTime& timeStamp,
     const unsigned int& seq);
 
+/**
+ * Crops `src` to `window` and shrinks it by the window decimation, averaging every decimation x decimation
+ * block of pixels (area averaging). Decimation is only supported for images with 8 bit channels
+ * (mono, rgb, bgr, rgba, bgra). Returns false if the window is empty or not supported.
+ */
+bool resampleColor(const yarp::sig::FlexImage& src, const IngestWindow& window, yarp::sig::FlexImage& dest);
+
+/**
+ * Crops `src` to `window` and shrinks it by the window decimation. With `window.minDepthPooling` every
+ * block gets its closest valid sample, so that thin objects are not lost, otherwise its top left one.
+ * Returns false if the window is empty.
+ */
+bool resampleDepth(const DepthImage& src, const IngestWindow& window, DepthImage& dest);
+
+/**
+ * Converts a depth image in metres into a `16UC1` one in millimetres (0 where there is no valid measurement).
+ */
+void depthToMillimetres(const DepthImage& src, yarp::sig::ImageOf<yarp::sig::PixelMono16>& dest);
+
+/**
+ * Fills a ImageWire message referencing `src`: no pixel is copied, `src` must stay untouched until the message is sent.
+ */
+void shallowCopyImages(const yarp::sig::Image& src,
+    ImageWire& dest,
+    const std::string& frame_id,
+    const yarp::rosmsg::TickTime& timeStamp,
+    const unsigned int& seq);
+
 void shallowCopyImages(const yarp::sig::FlexImage& src, yarp::sig::FlexImage& dest);
 
 void shallowCopyImages(const DepthImage& src, DepthImage& dest);
@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_CPU_FEATURES_H
+#define RGBD_ROS_CPU_FEATURES_H
+
+// Compile-time availability of the instruction sets used by the conversion kernels.
+// SSE2 and NEON are part of the baseline ABI of the targets where they are enabled,
+// SSSE3 and AVX2 need to be checked at runtime before use.
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#  define RGBD_ROS_HAS_SSE2 1
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define RGBD_ROS_HAS_SSSE3 1
+#  define RGBD_ROS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#  define RGBD_ROS_HAS_AVX2 1
+#  define RGBD_ROS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define RGBD_ROS_HAS_NEON 1
+#endif
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Implementations of the conversion kernels. The conversions pick the best one available at runtime,
+ * the `*With()` variants run a given one so that the tests can compare all of them.
+ */
+enum class SimdPath
+{
+    Scalar,
+    Sse2,
+    Ssse3,
+    Avx2,
+    Neon
+};
+
+inline bool cpuHasSsse3()
+{
+#if defined(RGBD_ROS_HAS_SSSE3)
+    static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+    return has_ssse3;
+#else
+    return false;
+#endif
+}
+
+inline bool cpuHasAvx2()
+{
+#if defined(RGBD_ROS_HAS_AVX2)
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+inline bool hostIsBigEndian()
+{
+    const unsigned short probe = 1;
+    return *reinterpret_cast<const unsigned char*>(&probe) == 0;
+}
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_CPU_FEATURES_H
@@ -0,0 +1,285 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "depthConversion.h"
+#include "cpuFeatures.h"
+
+#include <initializer_list>
+
+#if defined(RGBD_ROS_HAS_SSE2)
+#  include <emmintrin.h>
+#endif
+#if defined(RGBD_ROS_HAS_AVX2)
+#  include <immintrin.h>
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+#  include <arm_neon.h>
+#endif
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+typedef void (*Depth16UToFloatKernel)(const std::uint16_t*, float*, std::size_t, float, bool);
+typedef void (*FloatDepthTo16UKernel)(const float*, std::uint16_t*, std::size_t, float);
+
+inline std::uint16_t swap16(std::uint16_t v)
+{
+    return static_cast<std::uint16_t>((v << 8) | (v >> 8));
+}
+
+void depth16UToFloatScalar(const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes)
+{
+    if (swapBytes) {
+        for (std::size_t i = 0; i < count; i++) {
+            dst[i] = static_cast<float>(swap16(src[i])) * scale;
+        }
+    } else {
+        for (std::size_t i = 0; i < count; i++) {
+            dst[i] = static_cast<float>(src[i]) * scale;
+        }
+    }
+}
+
+#if defined(RGBD_ROS_HAS_SSE2)
+void depth16UToFloatSse2(const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 vscale = _mm_set1_ps(scale);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        if (swapBytes) {
+            v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        }
+        // zero-extended 16 bit values always fit the signed 32 bit conversion
+        const __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+        const __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(lo, vscale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(hi, vscale));
+    }
+    depth16UToFloatScalar(src + i, dst + i, count - i, scale, swapBytes);
+}
+#endif
+
+#if defined(RGBD_ROS_HAS_AVX2)
+RGBD_ROS_TARGET_AVX2
+void depth16UToFloatAvx2(const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes)
+{
+    const __m256 vscale = _mm256_set1_ps(scale);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        if (swapBytes) {
+            a = _mm_or_si128(_mm_slli_epi16(a, 8), _mm_srli_epi16(a, 8));
+            b = _mm_or_si128(_mm_slli_epi16(b, 8), _mm_srli_epi16(b, 8));
+        }
+        const __m256 fa = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(a));
+        const __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(b));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(fa, vscale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(fb, vscale));
+    }
+    depth16UToFloatScalar(src + i, dst + i, count - i, scale, swapBytes);
+}
+#endif
+
+#if defined(RGBD_ROS_HAS_NEON)
+void depth16UToFloatNeon(const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t v = vld1q_u16(src + i);
+        if (swapBytes) {
+            v = vreinterpretq_u16_u8(vrev16q_u8(vreinterpretq_u8_u16(v)));
+        }
+        const float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+        const float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(v)));
+        vst1q_f32(dst + i, vmulq_n_f32(lo, scale));
+        vst1q_f32(dst + i + 4, vmulq_n_f32(hi, scale));
+    }
+    depth16UToFloatScalar(src + i, dst + i, count - i, scale, swapBytes);
+}
+#endif
+
+// Returns nullptr if `path` is not compiled in or not supported by the CPU
+Depth16UToFloatKernel depth16UToFloatKernel(SimdPath path)
+{
+    switch (path) {
+    case SimdPath::Scalar:
+        return depth16UToFloatScalar;
+#if defined(RGBD_ROS_HAS_SSE2)
+    case SimdPath::Sse2:
+        return depth16UToFloatSse2;
+#endif
+#if defined(RGBD_ROS_HAS_AVX2)
+    case SimdPath::Avx2:
+        return cpuHasAvx2() ? depth16UToFloatAvx2 : nullptr;
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+    case SimdPath::Neon:
+        return depth16UToFloatNeon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+Depth16UToFloatKernel selectDepth16UToFloatKernel()
+{
+    for (SimdPath path : {SimdPath::Avx2, SimdPath::Sse2, SimdPath::Neon}) {
+        if (Depth16UToFloatKernel kernel = depth16UToFloatKernel(path)) {
+            return kernel;
+        }
+    }
+    return depth16UToFloatScalar;
+}
+
+// Every kernel rounds to nearest and stores 0 for the samples that are not finite, not positive or too
+// large: the SIMD comparisons are false for NaN exactly as the scalar ones, so all of them give the
+// same results.
+void floatDepthTo16UScalar(const float* src, std::uint16_t* dst, std::size_t count, float scale)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        const float v = src[i] * scale + 0.5f;
+        // NaN fails both comparisons
+        dst[i] = (v >= 1.0f && v < 65536.0f) ? static_cast<std::uint16_t>(v) : 0;
+    }
+}
+
+#if defined(RGBD_ROS_HAS_SSE2)
+inline __m128i floatDepthTo16USse2Lane(const float* src, __m128 vscale)
+{
+    const __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src), vscale), _mm_set1_ps(0.5f));
+    const __m128 valid = _mm_and_ps(_mm_cmpge_ps(v, _mm_set1_ps(1.0f)), _mm_cmplt_ps(v, _mm_set1_ps(65536.0f)));
+    return _mm_and_si128(_mm_cvttps_epi32(v), _mm_castps_si128(valid));
+}
+
+void floatDepthTo16USse2(const float* src, std::uint16_t* dst, std::size_t count, float scale)
+{
+    const __m128 vscale = _mm_set1_ps(scale);
+    // SSE2 has only the signed saturating pack: shift [0, 65535] to the int16 range and back
+    const __m128i bias32 = _mm_set1_epi32(32768);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i lo = _mm_sub_epi32(floatDepthTo16USse2Lane(src + i, vscale), bias32);
+        const __m128i hi = _mm_sub_epi32(floatDepthTo16USse2Lane(src + i + 4, vscale), bias32);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16));
+    }
+    floatDepthTo16UScalar(src + i, dst + i, count - i, scale);
+}
+#endif
+
+#if defined(RGBD_ROS_HAS_AVX2)
+RGBD_ROS_TARGET_AVX2
+inline __m256i floatDepthTo16UAvx2Lane(const float* src, __m256 vscale)
+{
+    const __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src), vscale), _mm256_set1_ps(0.5f));
+    const __m256 valid = _mm256_and_ps(_mm256_cmp_ps(v, _mm256_set1_ps(1.0f), _CMP_GE_OQ),
+                                       _mm256_cmp_ps(v, _mm256_set1_ps(65536.0f), _CMP_LT_OQ));
+    return _mm256_and_si256(_mm256_cvttps_epi32(v), _mm256_castps_si256(valid));
+}
+
+RGBD_ROS_TARGET_AVX2
+void floatDepthTo16UAvx2(const float* src, std::uint16_t* dst, std::size_t count, float scale)
+{
+    const __m256 vscale = _mm256_set1_ps(scale);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m256i a = floatDepthTo16UAvx2Lane(src + i, vscale);
+        const __m256i b = floatDepthTo16UAvx2Lane(src + i + 8, vscale);
+        // the pack works within the 128 bit lanes, put the four quarters back in order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(a, b), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+    }
+    floatDepthTo16UScalar(src + i, dst + i, count - i, scale);
+}
+#endif
+
+#if defined(RGBD_ROS_HAS_NEON)
+inline uint16x4_t floatDepthTo16UNeonLane(const float* src, float scale)
+{
+    const float32x4_t v = vaddq_f32(vmulq_n_f32(vld1q_f32(src), scale), vdupq_n_f32(0.5f));
+    const uint32x4_t valid = vandq_u32(vcgeq_f32(v, vdupq_n_f32(1.0f)), vcltq_f32(v, vdupq_n_f32(65536.0f)));
+    return vmovn_u32(vandq_u32(vcvtq_u32_f32(v), valid));
+}
+
+void floatDepthTo16UNeon(const float* src, std::uint16_t* dst, std::size_t count, float scale)
+{
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        vst1q_u16(dst + i, vcombine_u16(floatDepthTo16UNeonLane(src + i, scale), floatDepthTo16UNeonLane(src + i + 4, scale)));
+    }
+    floatDepthTo16UScalar(src + i, dst + i, count - i, scale);
+}
+#endif
+
+// Returns nullptr if `path` is not compiled in or not supported by the CPU
+FloatDepthTo16UKernel floatDepthTo16UKernel(SimdPath path)
+{
+    switch (path) {
+    case SimdPath::Scalar:
+        return floatDepthTo16UScalar;
+#if defined(RGBD_ROS_HAS_SSE2)
+    case SimdPath::Sse2:
+        return floatDepthTo16USse2;
+#endif
+#if defined(RGBD_ROS_HAS_AVX2)
+    case SimdPath::Avx2:
+        return cpuHasAvx2() ? floatDepthTo16UAvx2 : nullptr;
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+    case SimdPath::Neon:
+        return floatDepthTo16UNeon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+FloatDepthTo16UKernel selectFloatDepthTo16UKernel()
+{
+    for (SimdPath path : {SimdPath::Avx2, SimdPath::Sse2, SimdPath::Neon}) {
+        if (FloatDepthTo16UKernel kernel = floatDepthTo16UKernel(path)) {
+            return kernel;
+        }
+    }
+    return floatDepthTo16UScalar;
+}
+
+} // namespace
+
+void yarp::dev::RGBDRosConversionUtils::convertDepth16UToFloat(const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes)
+{
+    static const Depth16UToFloatKernel kernel = selectDepth16UToFloatKernel();
+    kernel(src, dst, count, scale, swapBytes);
+}
+
+void yarp::dev::RGBDRosConversionUtils::convertFloatDepthTo16U(const float* src, std::uint16_t* dst, std::size_t count, float scale)
+{
+    static const FloatDepthTo16UKernel kernel = selectFloatDepthTo16UKernel();
+    kernel(src, dst, count, scale);
+}
+
+bool yarp::dev::RGBDRosConversionUtils::convertDepth16UToFloatWith(SimdPath path, const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes)
+{
+    const Depth16UToFloatKernel kernel = depth16UToFloatKernel(path);
+    if (!kernel) {
+        return false;
+    }
+    kernel(src, dst, count, scale, swapBytes);
+    return true;
+}
+
+bool yarp::dev::RGBDRosConversionUtils::convertFloatDepthTo16UWith(SimdPath path, const float* src, std::uint16_t* dst, std::size_t count, float scale)
+{
+    const FloatDepthTo16UKernel kernel = floatDepthTo16UKernel(path);
+    if (!kernel) {
+        return false;
+    }
+    kernel(src, dst, count, scale);
+    return true;
+}
@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_DEPTH_CONVERSION_H
+#define RGBD_ROS_DEPTH_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpuFeatures.h"
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Default scale applied to 16 bit depth samples: ROS drivers publish `16UC1` depth in millimetres.
+ */
+constexpr double DEFAULT_DEPTH_SCALE = 0.001;
+
+/**
+ * Converts `count` unsigned 16 bit depth samples into float depth values, multiplying each one by `scale`.
+ * If `swapBytes` is set the samples are byte-swapped before the conversion (i.e. the payload endianness
+ * differs from the host one).
+ * The SIMD implementation (AVX2, SSE2, NEON or scalar fallback) is selected once at runtime.
+ */
+void convertDepth16UToFloat(const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes);
+
+/**
+ * Converts `count` float depth values into unsigned 16 bit samples, multiplying each one by `scale` and
+ * rounding to the nearest integer (e.g. metres to `16UC1` millimetres with a scale of 1000).
+ * Values that are not finite, not positive or that do not fit 16 bits are stored as 0 (no measurement, as
+ * in REP 118). The SIMD implementation (AVX2, SSE2, NEON or scalar fallback) is selected once at runtime.
+ */
+void convertFloatDepthTo16U(const float* src, std::uint16_t* dst, std::size_t count, float scale);
+
+/**
+ * Same as convertDepth16UToFloat() and convertFloatDepthTo16U(), but running the `path` implementation.
+ * Return false, without converting, if `path` is not compiled in or not supported by the CPU.
+ */
+bool convertDepth16UToFloatWith(SimdPath path, const std::uint16_t* src, float* dst, std::size_t count, float scale, bool swapBytes);
+bool convertFloatDepthTo16UWith(SimdPath path, const float* src, std::uint16_t* dst, std::size_t count, float scale);
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_DEPTH_CONVERSION_H
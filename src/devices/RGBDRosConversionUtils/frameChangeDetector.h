@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_FRAME_CHANGE_DETECTOR_H
+#define RGBD_ROS_FRAME_CHANGE_DETECTOR_H
+
+#include <atomic>
+#include <cstdint>
+
+#include <yarp/os/Stamp.h>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Tells apart new frames from the ones returned again by a sensor, comparing their stamps with
+ * the one of the last new frame of the same stream. Every wrapper instance keeps its own detectors,
+ * so that streams of different sensors never affect each other.
+ *
+ * isNew() must be called by a single thread; duplicates() can be read from any thread.
+ */
+class FrameChangeDetector
+{
+public:
+    /**
+     * Returns true if `stamp` is newer than the one of the last new frame, otherwise counts a duplicate.
+     */
+    bool isNew(const yarp::os::Stamp& stamp)
+    {
+        if (stamp.getTime() > m_last_time) {
+            m_last_time = stamp.getTime();
+            return true;
+        }
+        m_duplicates.store(m_duplicates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /**
+     * Number of frames that were not new since the detector was created.
+     */
+    std::uint64_t duplicates() const
+    {
+        return m_duplicates.load(std::memory_order_relaxed);
+    }
+
+private:
+    double                     m_last_time = 0;
+    std::atomic<std::uint64_t> m_duplicates {0};
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_FRAME_CHANGE_DETECTOR_H
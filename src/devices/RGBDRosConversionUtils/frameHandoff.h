@@ -0,0 +1,98 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_FRAME_HANDOFF_H
+#define RGBD_ROS_FRAME_HANDOFF_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Single-writer / multiple-readers handoff of the latest frame.
+ *
+ * The writer fills a buffer obtained with acquire() and makes it visible with publish().
+ * Readers get a reference counted pointer to the latest published frame with latest(), and
+ * can copy it without holding any lock: the writer never reuses a buffer that is still
+ * referenced by a reader, it picks a free one from its pool instead (or allocates a new one).
+ * With one reader at a time this degenerates into a classic triple buffer.
+ *
+ * Optionally the last few published frames are kept available through history(),
+ * e.g. to pair frames of different streams by timestamp.
+ *
+ * setHistoryDepth() must be called before the writer starts; acquire() and publish()
+ * must be called by a single thread.
+ */
+template <typename T>
+class FrameHandoff
+{
+public:
+    std::shared_ptr<T> acquire()
+    {
+        for (const auto& buffer : m_pool) {
+            if (buffer.use_count() == 1) {
+                // Pairs with the release decrement done by the last reader dropping the buffer
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return buffer;
+            }
+        }
+        m_pool.push_back(std::make_shared<T>());
+        return m_pool.back();
+    }
+
+    void publish(const std::shared_ptr<T>& frame)
+    {
+        std::shared_ptr<const T> published(frame);
+        if (!m_history.empty()) {
+            std::atomic_store(&m_history[m_published % m_history.size()], published);
+        }
+        m_published++;
+        std::atomic_store(&m_front, std::move(published));
+    }
+
+    std::shared_ptr<const T> latest() const
+    {
+        return std::atomic_load(&m_front);
+    }
+
+    void setHistoryDepth(size_t depth)
+    {
+        m_history.assign(depth > 1 ? depth : 0, nullptr);
+    }
+
+    /**
+     * Returns up to `history depth` recently published frames, in no particular order.
+     * Without a history only the latest frame (if any) is returned.
+     */
+    std::vector<std::shared_ptr<const T>> history() const
+    {
+        std::vector<std::shared_ptr<const T>> frames;
+        if (m_history.empty()) {
+            if (auto frame = latest()) {
+                frames.push_back(std::move(frame));
+            }
+            return frames;
+        }
+        frames.reserve(m_history.size());
+        for (const auto& slot : m_history) {
+            if (auto frame = std::atomic_load(&slot)) {
+                frames.push_back(std::move(frame));
+            }
+        }
+        return frames;
+    }
+
+private:
+    std::vector<std::shared_ptr<T>>       m_pool;
+    std::shared_ptr<const T>              m_front;
+    std::vector<std::shared_ptr<const T>> m_history;
+    size_t                                m_published = 0;
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_FRAME_HANDOFF_H
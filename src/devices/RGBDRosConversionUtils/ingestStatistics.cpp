@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "ingestStatistics.h"
+
+#include <cmath>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+// gain of the RFC 3550 jitter estimator
+constexpr double JITTER_GAIN = 1.0 / 16.0;
+
+// reset() runs on another thread (the rpc one): a load/store pair could write back a value read before
+// the reset, the read-modify-write operations cannot
+inline void increment(std::atomic<uint64_t>& counter, uint64_t amount = 1)
+{
+    counter.fetch_add(amount, std::memory_order_relaxed);
+}
+
+inline void raiseTo(std::atomic<uint64_t>& value, uint64_t candidate)
+{
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (candidate > current && !value.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+    }
+}
+}
+
+void DurationHistogram::add(double seconds)
+{
+    const uint64_t us = seconds > 0 ? static_cast<uint64_t>(seconds * 1e6) : 0;
+    size_t bucket = 0;
+    for (uint64_t v = us; v != 0 && bucket < BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    increment(m_buckets[bucket]);
+    increment(m_count);
+    increment(m_sum_us, us);
+    raiseTo(m_max_us, us);
+}
+
+void DurationHistogram::reset()
+{
+    for (auto& b : m_buckets) {
+        b.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum_us.store(0, std::memory_order_relaxed);
+    m_max_us.store(0, std::memory_order_relaxed);
+}
+
+void DurationHistogram::toBottle(yarp::os::Bottle& b) const
+{
+    const uint64_t count = m_count.load(std::memory_order_relaxed);
+    const uint64_t sum = m_sum_us.load(std::memory_order_relaxed);
+
+    yarp::os::Bottle& c = b.addList();
+    c.addString("count");
+    c.addInt64(static_cast<int64_t>(count));
+    yarp::os::Bottle& m = b.addList();
+    m.addString("mean_us");
+    m.addFloat64(count > 0 ? static_cast<double>(sum) / static_cast<double>(count) : 0.0);
+    yarp::os::Bottle& x = b.addList();
+    x.addString("max_us");
+    x.addInt64(static_cast<int64_t>(m_max_us.load(std::memory_order_relaxed)));
+    yarp::os::Bottle& h = b.addList();
+    h.addString("buckets_us");
+    yarp::os::Bottle& values = h.addList();
+    for (const auto& bucket : m_buckets) {
+        values.addInt64(static_cast<int64_t>(bucket.load(std::memory_order_relaxed)));
+    }
+}
+
+void IngestStatistics::onReceived(double headerTime, double receiveTime)
+{
+    increment(received);
+    if (m_last_receive > 0) {
+        interArrival.add(receiveTime - m_last_receive);
+    }
+    m_last_receive = receiveTime;
+
+    if (headerTime <= 0) {
+        m_has_transit = false;
+        return;
+    }
+    const double transit = receiveTime - headerTime;
+    latency.add(transit);
+    if (m_has_transit) {
+        // J += (|D| - J) / 16, D being the variation of the transit time (RFC 3550, A.8)
+        const double variation = std::fabs(transit - m_last_transit);
+        double j = jitter.load(std::memory_order_relaxed);
+        while (!jitter.compare_exchange_weak(j, j + (variation - j) * JITTER_GAIN, std::memory_order_relaxed)) {
+        }
+    }
+    m_last_transit = transit;
+    m_has_transit = true;
+}
+
+void IngestStatistics::reset()
+{
+    received.store(0, std::memory_order_relaxed);
+    rejected.store(0, std::memory_order_relaxed);
+    overwrittenUnread.store(0, std::memory_order_relaxed);
+    conversionTime.reset();
+    latency.reset();
+    interArrival.reset();
+    jitter.store(0, std::memory_order_relaxed);
+}
+
+void IngestStatistics::toBottle(yarp::os::Bottle& b) const
+{
+    yarp::os::Bottle& r = b.addList();
+    r.addString("received");
+    r.addInt64(static_cast<int64_t>(received.load(std::memory_order_relaxed)));
+    yarp::os::Bottle& d = b.addList();
+    d.addString("rejected");
+    d.addInt64(static_cast<int64_t>(rejected.load(std::memory_order_relaxed)));
+    yarp::os::Bottle& o = b.addList();
+    o.addString("overwritten_unread");
+    o.addInt64(static_cast<int64_t>(overwrittenUnread.load(std::memory_order_relaxed)));
+    yarp::os::Bottle& j = b.addList();
+    j.addString("jitter_s");
+    j.addFloat64(jitter.load(std::memory_order_relaxed));
+
+    yarp::os::Bottle& c = b.addList();
+    c.addString("conversion_time");
+    conversionTime.toBottle(c);
+    yarp::os::Bottle& l = b.addList();
+    l.addString("latency");
+    latency.toBottle(l);
+    yarp::os::Bottle& a = b.addList();
+    a.addString("inter_arrival");
+    interArrival.toBottle(a);
+}
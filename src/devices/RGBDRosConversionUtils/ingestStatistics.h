@@ -0,0 +1,78 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_INGEST_STATISTICS_H
+#define RGBD_ROS_INGEST_STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <yarp/os/Bottle.h>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Histogram of durations with power of two buckets: bucket i counts the samples in [2^(i-1), 2^i)
+ * microseconds (bucket 0 the ones below 1 us, the last one everything above).
+ * Samples are added by a single thread with relaxed atomic read-modify-write operations, so they can be
+ * read and reset at any time from other threads.
+ */
+class DurationHistogram
+{
+public:
+    static constexpr size_t BUCKETS = 24;
+
+    void add(double seconds);
+    void reset();
+
+    /**
+     * Appends `(count N) (mean_us M) (max_us X) (buckets_us (b0 b1 ...))` to `b`.
+     */
+    void toBottle(yarp::os::Bottle& b) const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets {};
+    std::atomic<uint64_t>                      m_count {0};
+    std::atomic<uint64_t>                      m_sum_us {0};
+    std::atomic<uint64_t>                      m_max_us {0};
+};
+
+/**
+ * Per-stream statistics collected while receiving frames.
+ * All the updates are lock free and done by the thread receiving the frames; reset() and toBottle()
+ * can be called concurrently from other threads.
+ */
+struct IngestStatistics
+{
+    std::atomic<uint64_t> received {0};           ///< messages received
+    std::atomic<uint64_t> rejected {0};           ///< messages dropped (invalid layout, unsupported encoding, post-processing failure)
+    std::atomic<uint64_t> overwrittenUnread {0};  ///< frames replaced by a newer one before anybody read them
+    DurationHistogram     conversionTime;         ///< time spent converting a message into a frame
+    DurationHistogram     latency;                ///< reception time minus header stamp (needs synchronized clocks)
+    DurationHistogram     interArrival;           ///< time between consecutive messages
+    std::atomic<double>   jitter {0};             ///< RFC 3550 interarrival jitter estimate, in seconds
+
+    /**
+     * Accounts for a message whose header stamp is `headerTime` (0 if missing) received at `receiveTime`.
+     */
+    void onReceived(double headerTime, double receiveTime);
+
+    void reset();
+
+    /**
+     * Appends the statistics to `b` as a list of (key value) pairs.
+     */
+    void toBottle(yarp::os::Bottle& b) const;
+
+private:
+    double m_last_receive = 0;
+    double m_last_transit = 0;
+    bool   m_has_transit = false;
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_INGEST_STATISTICS_H
@@ -0,0 +1,379 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pixelConversion.h"
+#include "cpuFeatures.h"
+
+#include <initializer_list>
+
+#if defined(RGBD_ROS_HAS_SSSE3)
+#  include <tmmintrin.h>
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+#  include <arm_neon.h>
+#endif
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+typedef void (*PixelKernel)(const std::uint8_t*, std::uint8_t*, std::size_t);
+
+void bgrToRgbScalar(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        dst[3 * i]     = src[3 * i + 2];
+        dst[3 * i + 1] = src[3 * i + 1];
+        dst[3 * i + 2] = src[3 * i];
+    }
+}
+
+void rgbaToRgbScalar(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        dst[3 * i]     = src[4 * i];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 2];
+    }
+}
+
+void bgraToRgbScalar(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    for (std::size_t i = 0; i < count; i++) {
+        dst[3 * i]     = src[4 * i + 2];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i];
+    }
+}
+
+#if defined(RGBD_ROS_HAS_SSSE3)
+// The SSSE3 kernels store 16 bytes per iteration but advance by less than that: the trailing
+// bytes of each store are garbage that the next iteration overwrites. The loop bounds keep
+// every load and store inside the buffers, the last pixels are left to the scalar code.
+
+RGBD_ROS_TARGET_SSSE3
+void bgrToRgbSsse3(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    std::size_t i = 0;
+    for (; i + 6 <= count; i += 5) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(v, mask));
+    }
+    bgrToRgbScalar(src + 3 * i, dst + 3 * i, count - i);
+}
+
+RGBD_ROS_TARGET_SSSE3
+void rgbaToRgbSsse3(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    std::size_t i = 0;
+    for (; i + 6 <= count; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(v, mask));
+    }
+    rgbaToRgbScalar(src + 4 * i, dst + 3 * i, count - i);
+}
+
+RGBD_ROS_TARGET_SSSE3
+void bgraToRgbSsse3(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    std::size_t i = 0;
+    for (; i + 6 <= count; i += 4) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(v, mask));
+    }
+    bgraToRgbScalar(src + 4 * i, dst + 3 * i, count - i);
+}
+#endif
+
+#if defined(RGBD_ROS_HAS_NEON)
+void bgrToRgbNeon(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x3_t v = vld3q_u8(src + 3 * i);
+        uint8x16x3_t out;
+        out.val[0] = v.val[2];
+        out.val[1] = v.val[1];
+        out.val[2] = v.val[0];
+        vst3q_u8(dst + 3 * i, out);
+    }
+    bgrToRgbScalar(src + 3 * i, dst + 3 * i, count - i);
+}
+
+void rgbaToRgbNeon(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x4_t v = vld4q_u8(src + 4 * i);
+        uint8x16x3_t out;
+        out.val[0] = v.val[0];
+        out.val[1] = v.val[1];
+        out.val[2] = v.val[2];
+        vst3q_u8(dst + 3 * i, out);
+    }
+    rgbaToRgbScalar(src + 4 * i, dst + 3 * i, count - i);
+}
+
+void bgraToRgbNeon(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x4_t v = vld4q_u8(src + 4 * i);
+        uint8x16x3_t out;
+        out.val[0] = v.val[2];
+        out.val[1] = v.val[1];
+        out.val[2] = v.val[0];
+        vst3q_u8(dst + 3 * i, out);
+    }
+    bgraToRgbScalar(src + 4 * i, dst + 3 * i, count - i);
+}
+#endif
+
+// Returns nullptr if `path` is not compiled in or not supported by the CPU
+PixelKernel bgrToRgbKernel(SimdPath path)
+{
+    switch (path) {
+    case SimdPath::Scalar:
+        return bgrToRgbScalar;
+#if defined(RGBD_ROS_HAS_SSSE3)
+    case SimdPath::Ssse3:
+        return cpuHasSsse3() ? bgrToRgbSsse3 : nullptr;
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+    case SimdPath::Neon:
+        return bgrToRgbNeon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+// Returns nullptr if `path` is not compiled in or not supported by the CPU
+PixelKernel rgbaToRgbKernel(SimdPath path)
+{
+    switch (path) {
+    case SimdPath::Scalar:
+        return rgbaToRgbScalar;
+#if defined(RGBD_ROS_HAS_SSSE3)
+    case SimdPath::Ssse3:
+        return cpuHasSsse3() ? rgbaToRgbSsse3 : nullptr;
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+    case SimdPath::Neon:
+        return rgbaToRgbNeon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+// Returns nullptr if `path` is not compiled in or not supported by the CPU
+PixelKernel bgraToRgbKernel(SimdPath path)
+{
+    switch (path) {
+    case SimdPath::Scalar:
+        return bgraToRgbScalar;
+#if defined(RGBD_ROS_HAS_SSSE3)
+    case SimdPath::Ssse3:
+        return cpuHasSsse3() ? bgraToRgbSsse3 : nullptr;
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+    case SimdPath::Neon:
+        return bgraToRgbNeon;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+PixelKernel selectPixelKernel(PixelKernel (*lookup)(SimdPath))
+{
+    for (SimdPath path : {SimdPath::Ssse3, SimdPath::Neon}) {
+        if (PixelKernel kernel = lookup(path)) {
+            return kernel;
+        }
+    }
+    return lookup(SimdPath::Scalar);
+}
+
+bool runPixelKernel(PixelKernel kernel, const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    if (!kernel) {
+        return false;
+    }
+    kernel(src, dst, count);
+    return true;
+}
+
+// Mirrors an out of range row/column index back into [0, n), preserving its parity
+// (and therefore its colour in the Bayer pattern) whenever possible.
+inline std::size_t mirror(std::ptrdiff_t i, std::size_t n)
+{
+    if (i < 0) {
+        return n > 1 ? 1 : 0;
+    }
+    if (static_cast<std::size_t>(i) >= n) {
+        return n > 1 ? n - 2 : n - 1;
+    }
+    return static_cast<std::size_t>(i);
+}
+
+// Bilinear interpolation of one pixel.
+// `rowChannel` is the output channel of the non-green samples of the current row (red or blue),
+// `otherChannel` the one of the non-green samples of the rows above and below.
+inline void demosaicPixel(const std::uint8_t* up, const std::uint8_t* mid, const std::uint8_t* down,
+                          std::size_t xl, std::size_t x, std::size_t xr,
+                          bool colourSample, std::uint8_t* px, int rowChannel, int otherChannel)
+{
+    if (colourSample) {
+        px[rowChannel] = mid[x];
+        px[1] = static_cast<std::uint8_t>((mid[xl] + mid[xr] + up[x] + down[x] + 2) >> 2);
+        px[otherChannel] = static_cast<std::uint8_t>((up[xl] + up[xr] + down[xl] + down[xr] + 2) >> 2);
+    } else {
+        px[1] = mid[x];
+        px[rowChannel] = static_cast<std::uint8_t>((mid[xl] + mid[xr] + 1) >> 1);
+        px[otherChannel] = static_cast<std::uint8_t>((up[x] + down[x] + 1) >> 1);
+    }
+}
+
+void bayerParity(BayerPattern pattern, std::size_t& redRowParity, std::size_t& redColParity)
+{
+    switch (pattern) {
+    case BayerPattern::RGGB: redRowParity = 0; redColParity = 0; break;
+    case BayerPattern::BGGR: redRowParity = 1; redColParity = 1; break;
+    case BayerPattern::GRBG: redRowParity = 0; redColParity = 1; break;
+    case BayerPattern::GBRG: redRowParity = 1; redColParity = 0; break;
+    }
+}
+
+} // namespace
+
+void yarp::dev::RGBDRosConversionUtils::convertBgrToRgb(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    static const PixelKernel kernel = selectPixelKernel(bgrToRgbKernel);
+    kernel(src, dst, count);
+}
+
+void yarp::dev::RGBDRosConversionUtils::convertRgbaToRgb(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    static const PixelKernel kernel = selectPixelKernel(rgbaToRgbKernel);
+    kernel(src, dst, count);
+}
+
+void yarp::dev::RGBDRosConversionUtils::convertBgraToRgb(const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    static const PixelKernel kernel = selectPixelKernel(bgraToRgbKernel);
+    kernel(src, dst, count);
+}
+
+void yarp::dev::RGBDRosConversionUtils::demosaicBayer8(const std::uint8_t* src, std::size_t srcStep,
+                                                       std::uint8_t* dst, std::size_t dstStep,
+                                                       std::size_t width, std::size_t height,
+                                                       BayerPattern pattern, bool bgrOutput)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+
+    // row and column parity of the red samples
+    std::size_t redRowParity = 0;
+    std::size_t redColParity = 0;
+    bayerParity(pattern, redRowParity, redColParity);
+    const int redChannel = bgrOutput ? 2 : 0;
+    const int blueChannel = bgrOutput ? 0 : 2;
+
+    for (std::size_t y = 0; y < height; y++) {
+        const auto iy = static_cast<std::ptrdiff_t>(y);
+        const std::uint8_t* up = src + mirror(iy - 1, height) * srcStep;
+        const std::uint8_t* mid = src + y * srcStep;
+        const std::uint8_t* down = src + mirror(iy + 1, height) * srcStep;
+        std::uint8_t* out = dst + y * dstStep;
+
+        const bool redRow = (y & 1) == redRowParity;
+        const int rowChannel = redRow ? redChannel : blueChannel;
+        const int otherChannel = redRow ? blueChannel : redChannel;
+        // column parity of the red (blue) samples of a red (blue) row
+        const std::size_t colourParity = redRow ? redColParity : (redColParity ^ 1);
+
+        // borders
+        demosaicPixel(up, mid, down, mirror(-1, width), 0, mirror(1, width),
+                      colourParity == 0, out, rowChannel, otherChannel);
+        if (width > 1) {
+            const auto last = static_cast<std::ptrdiff_t>(width - 1);
+            demosaicPixel(up, mid, down, mirror(last - 1, width), width - 1, mirror(last + 1, width),
+                          ((width - 1) & 1) == colourParity, out + 3 * (width - 1), rowChannel, otherChannel);
+        }
+
+        // interior, two pixels at a time so that the sample colours are fixed within the loop body
+        std::size_t x = 1;
+        const bool firstIsColour = (x & 1) == colourParity;
+        for (; x + 2 < width; x += 2) {
+            demosaicPixel(up, mid, down, x - 1, x, x + 1, firstIsColour, out + 3 * x, rowChannel, otherChannel);
+            demosaicPixel(up, mid, down, x, x + 1, x + 2, !firstIsColour, out + 3 * (x + 1), rowChannel, otherChannel);
+        }
+        if (x + 1 < width) {
+            demosaicPixel(up, mid, down, x - 1, x, x + 1, firstIsColour, out + 3 * x, rowChannel, otherChannel);
+        }
+    }
+}
+
+bool yarp::dev::RGBDRosConversionUtils::convertBgrToRgbWith(SimdPath path, const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    return runPixelKernel(bgrToRgbKernel(path), src, dst, count);
+}
+
+bool yarp::dev::RGBDRosConversionUtils::convertRgbaToRgbWith(SimdPath path, const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    return runPixelKernel(rgbaToRgbKernel(path), src, dst, count);
+}
+
+bool yarp::dev::RGBDRosConversionUtils::convertBgraToRgbWith(SimdPath path, const std::uint8_t* src, std::uint8_t* dst, std::size_t count)
+{
+    return runPixelKernel(bgraToRgbKernel(path), src, dst, count);
+}
+
+yarp::dev::RGBDRosConversionUtils::BayerPattern yarp::dev::RGBDRosConversionUtils::bayerPatternAt(BayerPattern pattern, std::size_t x, std::size_t y)
+{
+    std::size_t redRowParity = 0;
+    std::size_t redColParity = 0;
+    bayerParity(pattern, redRowParity, redColParity);
+    redRowParity ^= (y & 1);
+    redColParity ^= (x & 1);
+    if (redRowParity == 0) {
+        return redColParity == 0 ? BayerPattern::RGGB : BayerPattern::GRBG;
+    }
+    return redColParity == 0 ? BayerPattern::GBRG : BayerPattern::BGGR;
+}
+
+void yarp::dev::RGBDRosConversionUtils::binBayer8(const std::uint8_t* src, std::size_t srcStep,
+                                                  std::uint8_t* dst, std::size_t dstStep,
+                                                  std::size_t outWidth, std::size_t outHeight, std::size_t decimation,
+                                                  BayerPattern pattern, bool bgrOutput)
+{
+    std::size_t redRowParity = 0;
+    std::size_t redColParity = 0;
+    bayerParity(pattern, redRowParity, redColParity);
+    const int redChannel = bgrOutput ? 2 : 0;
+    const int blueChannel = bgrOutput ? 0 : 2;
+    // offsets of the samples inside a 2x2 cell
+    const std::size_t red = redRowParity * srcStep + redColParity;
+    const std::size_t blue = (redRowParity ^ 1) * srcStep + (redColParity ^ 1);
+    const std::size_t green1 = redRowParity * srcStep + (redColParity ^ 1);
+    const std::size_t green2 = (redRowParity ^ 1) * srcStep + redColParity;
+
+    for (std::size_t r = 0; r < outHeight; r++) {
+        const std::uint8_t* row = src + ((r * decimation) & ~static_cast<std::size_t>(1)) * srcStep;
+        std::uint8_t* out = dst + r * dstStep;
+        for (std::size_t c = 0; c < outWidth; c++) {
+            const std::uint8_t* cell = row + ((c * decimation) & ~static_cast<std::size_t>(1));
+            out[3 * c + redChannel] = cell[red];
+            out[3 * c + 1] = static_cast<std::uint8_t>((cell[green1] + cell[green2] + 1) >> 1);
+            out[3 * c + blueChannel] = cell[blue];
+        }
+    }
+}
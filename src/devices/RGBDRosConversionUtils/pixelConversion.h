@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_PIXEL_CONVERSION_H
+#define RGBD_ROS_PIXEL_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cpuFeatures.h"
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Swaps the first and third channel of `count` packed 3 byte pixels (BGR to RGB or RGB to BGR).
+ * `src` and `dst` must not overlap.
+ */
+void convertBgrToRgb(const std::uint8_t* src, std::uint8_t* dst, std::size_t count);
+
+/**
+ * Drops the alpha channel of `count` packed 4 byte pixels (RGBA to RGB or BGRA to BGR).
+ */
+void convertRgbaToRgb(const std::uint8_t* src, std::uint8_t* dst, std::size_t count);
+
+/**
+ * Drops the alpha channel of `count` packed 4 byte pixels and swaps the first and third channel
+ * (BGRA to RGB or RGBA to BGR).
+ */
+void convertBgraToRgb(const std::uint8_t* src, std::uint8_t* dst, std::size_t count);
+
+/**
+ * Same as convertBgrToRgb(), convertRgbaToRgb() and convertBgraToRgb(), but running the `path` implementation.
+ * Return false, without converting, if `path` is not compiled in or not supported by the CPU.
+ */
+bool convertBgrToRgbWith(SimdPath path, const std::uint8_t* src, std::uint8_t* dst, std::size_t count);
+bool convertRgbaToRgbWith(SimdPath path, const std::uint8_t* src, std::uint8_t* dst, std::size_t count);
+bool convertBgraToRgbWith(SimdPath path, const std::uint8_t* src, std::uint8_t* dst, std::size_t count);
+
+/**
+ * Position of the red sample in the 2x2 cell at the top left corner of a Bayer image.
+ */
+enum class BayerPattern
+{
+    RGGB,
+    BGGR,
+    GRBG,
+    GBRG
+};
+
+/**
+ * Bilinear demosaicing of an 8 bit Bayer image into packed 3 byte pixels, RGB ordered or,
+ * if `bgrOutput` is set, BGR ordered.
+ * `srcStep` and `dstStep` are the row sizes in bytes of the source and of the destination.
+ * The image borders are handled by mirroring the neighbouring rows and columns.
+ */
+void demosaicBayer8(const std::uint8_t* src, std::size_t srcStep,
+                    std::uint8_t* dst, std::size_t dstStep,
+                    std::size_t width, std::size_t height,
+                    BayerPattern pattern, bool bgrOutput);
+
+/**
+ * Returns the pattern of the sub-image of a `pattern` Bayer image starting at column `x` and row `y`.
+ */
+BayerPattern bayerPatternAt(BayerPattern pattern, std::size_t x, std::size_t y);
+
+/**
+ * Reduced resolution conversion of an 8 bit Bayer image: the output pixel (c, r) is built from the 2x2
+ * cell found at (c * decimation, r * decimation), rounded down to even coordinates (red, average of the two
+ * greens, blue). `decimation` must be at least 2 and the source must hold `outWidth * decimation` columns
+ * and `outHeight * decimation` rows.
+ */
+void binBayer8(const std::uint8_t* src, std::size_t srcStep,
+               std::uint8_t* dst, std::size_t dstStep,
+               std::size_t outWidth, std::size_t outHeight, std::size_t decimation,
+               BayerPattern pattern, bool bgrOutput);
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_PIXEL_CONVERSION_H
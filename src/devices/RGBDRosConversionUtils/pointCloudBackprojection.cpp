@@ -0,0 +1,293 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "pointCloudBackprojection.h"
+#include "cpuFeatures.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(RGBD_ROS_HAS_SSE2)
+#  include <emmintrin.h>
+#  include <xmmintrin.h>
+#endif
+#if defined(RGBD_ROS_HAS_NEON)
+#  include <arm_neon.h>
+#endif
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+// b, g, r, a bytes in memory order, whatever the host endianness
+template <std::size_t R, std::size_t G, std::size_t B>
+inline std::uint32_t packColor(const unsigned char* pixel)
+{
+    const unsigned char bgra[4] = {pixel[B], pixel[G], pixel[R], 255};
+    std::uint32_t packed;
+    memcpy(&packed, bgra, sizeof(packed));
+    return packed;
+}
+
+inline void writePoint(unsigned char* out, float x, float y, float z, std::uint32_t rgb)
+{
+    const float xyz[4] = {x, y, z, 0.0f};
+    const std::uint32_t tail[4] = {rgb, 0, 0, 0};
+    memcpy(out, xyz, sizeof(xyz));
+    memcpy(out + POINT_XYZRGB_RGB_OFFSET, tail, sizeof(tail));
+}
+
+// the accepted depths, as a closed interval whose comparisons are false for NaN
+struct DepthInterval
+{
+    float low;
+    float high;
+};
+
+inline DepthInterval toInterval(const BackprojectionFilter& filter)
+{
+    // without limits, the interval still excludes 0, the negative values and infinity
+    return {filter.minDepth > 0.0f ? filter.minDepth : std::numeric_limits<float>::denorm_min(),
+            filter.maxDepth > 0.0f ? filter.maxDepth : std::numeric_limits<float>::max()};
+}
+
+inline bool isValid(float depth, const DepthInterval& interval)
+{
+    return depth >= interval.low && depth <= interval.high;
+}
+
+// Writes the points of one sampled image row, whose rays are (columns[i], rayY, 1) and whose depth and color
+// samples are `stride` pixels apart; invalid pixels give NaN points or, with removeInvalid, are skipped.
+// The SIMD loops process four samples at a time, transposing the x, y, z vectors into the four points.
+template <std::size_t PixelSize, std::size_t R, std::size_t G, std::size_t B>
+void backprojectRow(const float* depth,
+                    const unsigned char* color,
+                    const float* columns,
+                    float rayY,
+                    std::size_t width,
+                    std::size_t stride,
+                    const DepthInterval& interval,
+                    bool removeInvalid,
+                    unsigned char* out)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const std::size_t colorStep = stride * PixelSize;
+    std::size_t i = 0;
+
+#if defined(RGBD_ROS_HAS_SSE2)
+    const __m128 vlow = _mm_set1_ps(interval.low);
+    const __m128 vhigh = _mm_set1_ps(interval.high);
+    const __m128 vnan = _mm_set1_ps(nan);
+    const __m128 vrayY = _mm_set1_ps(rayY);
+    for (; i + 4 <= width; i += 4) {
+        const __m128 d = stride == 1 ? _mm_loadu_ps(depth + i)
+                                     : _mm_set_ps(depth[(i + 3) * stride], depth[(i + 2) * stride], depth[(i + 1) * stride], depth[i * stride]);
+        const __m128 valid = _mm_and_ps(_mm_cmpge_ps(d, vlow), _mm_cmple_ps(d, vhigh));
+        const int mask = _mm_movemask_ps(valid);
+        if (removeInvalid && mask == 0) {
+            continue;
+        }
+        __m128 p[4] = {_mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(d, _mm_loadu_ps(columns + i))), _mm_andnot_ps(valid, vnan)),
+                       _mm_or_ps(_mm_and_ps(valid, _mm_mul_ps(d, vrayY)), _mm_andnot_ps(valid, vnan)),
+                       _mm_or_ps(_mm_and_ps(valid, d), _mm_andnot_ps(valid, vnan)),
+                       _mm_setzero_ps()};
+        _MM_TRANSPOSE4_PS(p[0], p[1], p[2], p[3]);
+        const unsigned char* c = color + i * colorStep;
+        for (std::size_t k = 0; k < 4; k++) {
+            if (removeInvalid && (mask & (1 << k)) == 0) {
+                continue;
+            }
+            const __m128i rgb = _mm_cvtsi32_si128(static_cast<int>(packColor<R, G, B>(c + k * colorStep)));
+            _mm_storeu_ps(reinterpret_cast<float*>(out), p[k]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + POINT_XYZRGB_RGB_OFFSET), rgb);
+            out += POINT_XYZRGB_STEP;
+        }
+    }
+#elif defined(RGBD_ROS_HAS_NEON)
+    const float32x4_t vlow = vdupq_n_f32(interval.low);
+    const float32x4_t vhigh = vdupq_n_f32(interval.high);
+    const float32x4_t vnan = vdupq_n_f32(nan);
+    const float32x4_t vzero = vdupq_n_f32(0.0f);
+    for (; i + 4 <= width; i += 4) {
+        float32x4_t d;
+        if (stride == 1) {
+            d = vld1q_f32(depth + i);
+        } else {
+            const float samples[4] = {depth[i * stride], depth[(i + 1) * stride], depth[(i + 2) * stride], depth[(i + 3) * stride]};
+            d = vld1q_f32(samples);
+        }
+        const uint32x4_t valid = vandq_u32(vcgeq_f32(d, vlow), vcleq_f32(d, vhigh));
+        std::uint32_t lanes[4];
+        vst1q_u32(lanes, valid);
+        if (removeInvalid && (lanes[0] | lanes[1] | lanes[2] | lanes[3]) == 0) {
+            continue;
+        }
+        const float32x4_t x = vbslq_f32(valid, vmulq_f32(d, vld1q_f32(columns + i)), vnan);
+        const float32x4_t y = vbslq_f32(valid, vmulq_n_f32(d, rayY), vnan);
+        const float32x4_t z = vbslq_f32(valid, d, vnan);
+        const float32x4x2_t xy = vzipq_f32(x, y);
+        const float32x4x2_t zw = vzipq_f32(z, vzero);
+        const float32x4_t p[4] = {vcombine_f32(vget_low_f32(xy.val[0]), vget_low_f32(zw.val[0])),
+                                  vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(zw.val[0])),
+                                  vcombine_f32(vget_low_f32(xy.val[1]), vget_low_f32(zw.val[1])),
+                                  vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(zw.val[1]))};
+        const unsigned char* c = color + i * colorStep;
+        for (std::size_t k = 0; k < 4; k++) {
+            if (removeInvalid && lanes[k] == 0) {
+                continue;
+            }
+            const uint32x4_t rgb = vsetq_lane_u32(packColor<R, G, B>(c + k * colorStep), vdupq_n_u32(0), 0);
+            vst1q_f32(reinterpret_cast<float*>(out), p[k]);
+            vst1q_u32(reinterpret_cast<std::uint32_t*>(out + POINT_XYZRGB_RGB_OFFSET), rgb);
+            out += POINT_XYZRGB_STEP;
+        }
+    }
+#endif
+
+    for (; i < width; i++) {
+        const float d = depth[i * stride];
+        const bool valid = isValid(d, interval);
+        if (removeInvalid && !valid) {
+            continue;
+        }
+        writePoint(out,
+                   valid ? d * columns[i] : nan,
+                   valid ? d * rayY : nan,
+                   valid ? d : nan,
+                   packColor<R, G, B>(color + i * colorStep));
+        out += POINT_XYZRGB_STEP;
+    }
+}
+
+template <std::size_t PixelSize, std::size_t R, std::size_t G, std::size_t B>
+void backprojectRowRange(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth,
+                         const yarp::sig::Image& color,
+                         const RayTable& rays,
+                         const BackprojectionFilter& filter,
+                         std::size_t rowBegin,
+                         std::size_t rowEnd,
+                         unsigned char* cloud,
+                         const std::size_t* rowOffsets)
+{
+    const std::size_t width = rays.width();
+    const std::size_t stride = rays.stride();
+    const DepthInterval interval = toInterval(filter);
+    for (std::size_t r = rowBegin; r < rowEnd; r++) {
+        const std::size_t firstPoint = filter.removeInvalid ? rowOffsets[r] : r * width;
+        backprojectRow<PixelSize, R, G, B>(reinterpret_cast<const float*>(depth.getRow(r * stride)),
+                                           color.getRow(r * stride),
+                                           rays.columns(),
+                                           rays.rows()[r],
+                                           width,
+                                           stride,
+                                           interval,
+                                           filter.removeInvalid,
+                                           cloud + firstPoint * POINT_XYZRGB_STEP);
+    }
+}
+
+} // namespace
+
+void yarp::dev::RGBDRosConversionUtils::fillPointXYZRGBFields(std::vector<yarp::rosmsg::sensor_msgs::PointField>& fields)
+{
+    const char* names[4] = {"x", "y", "z", "rgb"};
+    const std::uint32_t offsets[4] = {0, 4, 8, POINT_XYZRGB_RGB_OFFSET};
+    fields.resize(4);
+    for (std::size_t i = 0; i < 4; i++) {
+        fields[i].name = names[i];
+        fields[i].offset = offsets[i];
+        fields[i].datatype = yarp::rosmsg::sensor_msgs::PointField::FLOAT32;
+        fields[i].count = 1;
+    }
+}
+
+void RayTable::update(const yarp::sig::IntrinsicParams& intrinsics, std::size_t width, std::size_t height, std::size_t stride)
+{
+    stride = stride > 0 ? stride : 1;
+    if (width == m_sourceWidth && height == m_sourceHeight && stride == m_stride &&
+        intrinsics.focalLengthX == m_fx && intrinsics.focalLengthY == m_fy &&
+        intrinsics.principalPointX == m_cx && intrinsics.principalPointY == m_cy) {
+        return;
+    }
+    m_fx = intrinsics.focalLengthX;
+    m_fy = intrinsics.focalLengthY;
+    m_cx = intrinsics.principalPointX;
+    m_cy = intrinsics.principalPointY;
+    m_stride = stride;
+    m_sourceWidth = width;
+    m_sourceHeight = height;
+
+    m_columns.resize((width + stride - 1) / stride);
+    for (std::size_t i = 0; i < m_columns.size(); i++) {
+        m_columns[i] = static_cast<float>((static_cast<double>(i * stride) - m_cx) / m_fx);
+    }
+    m_rows.resize((height + stride - 1) / stride);
+    for (std::size_t j = 0; j < m_rows.size(); j++) {
+        m_rows[j] = static_cast<float>((static_cast<double>(j * stride) - m_cy) / m_fy);
+    }
+}
+
+bool yarp::dev::RGBDRosConversionUtils::isBackprojectionSupported(int pixelCode)
+{
+    switch (pixelCode) {
+    case VOCAB_PIXEL_MONO:
+    case VOCAB_PIXEL_RGB:
+    case VOCAB_PIXEL_BGR:
+    case VOCAB_PIXEL_RGBA:
+    case VOCAB_PIXEL_BGRA:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::size_t yarp::dev::RGBDRosConversionUtils::countValidPoints(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth,
+                                                                 const RayTable& rays,
+                                                                 const BackprojectionFilter& filter,
+                                                                 std::size_t row)
+{
+    const DepthInterval interval = toInterval(filter);
+    const std::size_t stride = rays.stride();
+    const auto* d = reinterpret_cast<const float*>(depth.getRow(row * stride));
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < rays.width(); i++) {
+        count += isValid(d[i * stride], interval) ? 1 : 0;
+    }
+    return count;
+}
+
+void yarp::dev::RGBDRosConversionUtils::backprojectRows(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth,
+                                                         const yarp::sig::Image& color,
+                                                         const RayTable& rays,
+                                                         const BackprojectionFilter& filter,
+                                                         std::size_t rowBegin,
+                                                         std::size_t rowEnd,
+                                                         unsigned char* cloud,
+                                                         const std::size_t* rowOffsets)
+{
+    if (filter.removeInvalid && rowOffsets == nullptr) {
+        return;
+    }
+    switch (color.getPixelCode()) {
+    case VOCAB_PIXEL_MONO:
+        backprojectRowRange<1, 0, 0, 0>(depth, color, rays, filter, rowBegin, rowEnd, cloud, rowOffsets);
+        break;
+    case VOCAB_PIXEL_RGB:
+        backprojectRowRange<3, 0, 1, 2>(depth, color, rays, filter, rowBegin, rowEnd, cloud, rowOffsets);
+        break;
+    case VOCAB_PIXEL_BGR:
+        backprojectRowRange<3, 2, 1, 0>(depth, color, rays, filter, rowBegin, rowEnd, cloud, rowOffsets);
+        break;
+    case VOCAB_PIXEL_RGBA:
+        backprojectRowRange<4, 0, 1, 2>(depth, color, rays, filter, rowBegin, rowEnd, cloud, rowOffsets);
+        break;
+    case VOCAB_PIXEL_BGRA:
+        backprojectRowRange<4, 2, 1, 0>(depth, color, rays, filter, rowBegin, rowEnd, cloud, rowOffsets);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_POINT_CLOUD_BACKPROJECTION_H
+#define RGBD_ROS_POINT_CLOUD_BACKPROJECTION_H
+
+#include <cstddef>
+#include <vector>
+
+#include <yarp/sig/Image.h>
+#include <yarp/sig/IntrinsicParams.h>
+#include <yarp/rosmsg/sensor_msgs/PointField.h>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Layout of the points written by backprojectRows(), the same of the PCL `PointXYZRGB`: `x`, `y` and `z`
+ * (float32) at offsets 0, 4 and 8, and `rgb` (b, g, r, a bytes packed in a float32) at offset 16.
+ * The unused bytes are set to 0.
+ */
+constexpr std::size_t POINT_XYZRGB_STEP = 32;
+constexpr std::size_t POINT_XYZRGB_RGB_OFFSET = 16;
+
+/**
+ * Replaces `fields` with the description of the POINT_XYZRGB_STEP layout, for a `PointCloud2` message.
+ */
+void fillPointXYZRGBFields(std::vector<yarp::rosmsg::sensor_msgs::PointField>& fields);
+
+/**
+ * Viewing rays of the pixels of a pinhole camera, sampled every `stride` pixels: the point seen at depth `d`
+ * by the sampled pixel (i, j), i.e. the image pixel (i * stride, j * stride), is `d * (columns()[i], rows()[j], 1)`.
+ * For the pinhole model the per pixel ray is separable, so the table stores its two factors (width + height
+ * values) instead of one ray per pixel.
+ */
+class RayTable
+{
+public:
+    /**
+     * Rebuilds the table for a `width` x `height` image sampled every `stride` pixels, unless it already
+     * matches `intrinsics`, size and stride.
+     */
+    void update(const yarp::sig::IntrinsicParams& intrinsics, std::size_t width, std::size_t height, std::size_t stride = 1);
+
+    /// number of sampled columns and rows
+    std::size_t width() const { return m_columns.size(); }
+    std::size_t height() const { return m_rows.size(); }
+    std::size_t stride() const { return m_stride; }
+    const float* columns() const { return m_columns.data(); }
+    const float* rows() const { return m_rows.data(); }
+
+private:
+    double             m_fx = 0;
+    double             m_fy = 0;
+    double             m_cx = 0;
+    double             m_cy = 0;
+    std::size_t        m_stride = 1;
+    std::size_t        m_sourceWidth = 0;
+    std::size_t        m_sourceHeight = 0;
+    std::vector<float> m_columns;
+    std::vector<float> m_rows;
+};
+
+/**
+ * Pixels accepted by backprojectRows(): a pixel is valid if its depth is finite, positive and within
+ * [minDepth, maxDepth] (0 means no limit). Invalid pixels give NaN points, or no point at all if
+ * `removeInvalid` is set.
+ */
+struct BackprojectionFilter
+{
+    float minDepth = 0.0f;
+    float maxDepth = 0.0f;
+    bool  removeInvalid = false;
+};
+
+/**
+ * Whether color images with pixel code `pixelCode` can be passed to backprojectRows()
+ * (mono, rgb, bgr, rgba and bgra).
+ */
+bool isBackprojectionSupported(int pixelCode);
+
+/**
+ * Number of valid pixels (see BackprojectionFilter) in the sampled row `row` of `depth`, i.e. the points
+ * that backprojectRows() writes for it when `filter.removeInvalid` is set.
+ */
+std::size_t countValidPoints(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth,
+                             const RayTable& rays,
+                             const BackprojectionFilter& filter,
+                             std::size_t row);
+
+/**
+ * Backprojects the sampled rows [rowBegin, rowEnd) of `depth` (metres), writing the points straight into
+ * `cloud` (POINT_XYZRGB_STEP layout). `color` must have the size of `depth` and a supported pixel code, and
+ * `rays` must have been updated for the same size.
+ * Without `filter.removeInvalid` the cloud holds `rays.width() * rays.height()` points in row major order and
+ * the invalid pixels get NaN coordinates; with it only the valid pixels are written, those of row `r` starting
+ * from the point `rowOffsets[r]` (which is then required, see countValidPoints()).
+ * Disjoint row ranges can be processed concurrently. The SIMD implementation (SSE2, NEON or scalar
+ * fallback) is selected at compile time.
+ */
+void backprojectRows(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth,
+                     const yarp::sig::Image& color,
+                     const RayTable& rays,
+                     const BackprojectionFilter& filter,
+                     std::size_t rowBegin,
+                     std::size_t rowEnd,
+                     unsigned char* cloud,
+                     const std::size_t* rowOffsets = nullptr);
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_POINT_CLOUD_BACKPROJECTION_H
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "rosImageWire.h"
+
+#include <cstring>
+
+#include <yarp/conf/compiler.h>
+
+#include <yarp/rosmsg/sensor_msgs/Image.h>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+void ImageWire::setImage(const yarp::sig::Image& image)
+{
+    m_image = &image;
+}
+
+const yarp::sig::Image* ImageWire::getImage() const
+{
+    return m_image;
+}
+
+bool ImageWire::read(yarp::os::ConnectionReader& connection)
+{
+    YARP_UNUSED(connection);
+    // This message is meant to be published only
+    return false;
+}
+
+bool ImageWire::readBare(yarp::os::ConnectionReader& connection)
+{
+    return read(connection);
+}
+
+bool ImageWire::readBottle(yarp::os::ConnectionReader& connection)
+{
+    return read(connection);
+}
+
+bool ImageWire::write(yarp::os::ConnectionWriter& connection) const
+{
+    if (connection.isBareMode()) {
+        return writeBare(connection);
+    }
+    return writeBottle(connection);
+}
+
+bool ImageWire::writeBare(yarp::os::ConnectionWriter& connection) const
+{
+    // Same layout as yarp::rosmsg::sensor_msgs::Image::writeBare(), the pixels are appended
+    // as an external block, i.e. they are sent directly from the image memory.
+    if (!header.write(connection)) {
+        return false;
+    }
+
+    const std::uint32_t height = m_image ? static_cast<std::uint32_t>(m_image->height()) : 0;
+    const std::uint32_t width = m_image ? static_cast<std::uint32_t>(m_image->width()) : 0;
+    const std::uint32_t step = m_image ? static_cast<std::uint32_t>(m_image->getRowSize()) : 0;
+    const std::uint32_t size = m_image ? static_cast<std::uint32_t>(m_image->getRawImageSize()) : 0;
+
+    connection.appendInt32(height);
+    connection.appendInt32(width);
+
+    connection.appendInt32(static_cast<std::int32_t>(encoding.length()));
+    connection.appendExternalBlock(encoding.c_str(), encoding.length());
+
+    connection.appendInt8(is_bigendian);
+    connection.appendInt32(step);
+
+    connection.appendInt32(size);
+    if (size > 0) {
+        connection.appendExternalBlock(reinterpret_cast<const char*>(m_image->getRawImage()), size);
+    }
+
+    return !connection.isError();
+}
+
+bool ImageWire::writeBottle(yarp::os::ConnectionWriter& connection) const
+{
+    // Not used by ROS connections: fall back to a regular message
+    yarp::rosmsg::sensor_msgs::Image msg;
+    msg.header = header;
+    msg.encoding = encoding;
+    msg.is_bigendian = is_bigendian;
+    if (m_image) {
+        msg.height = m_image->height();
+        msg.width = m_image->width();
+        msg.step = m_image->getRowSize();
+        msg.data.resize(m_image->getRawImageSize());
+        memcpy(msg.data.data(), m_image->getRawImage(), m_image->getRawImageSize());
+    }
+    return msg.write(connection);
+}
+
+yarp::os::Type ImageWire::getType() const
+{
+    return yarp::rosmsg::sensor_msgs::Image().getType();
+}
@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_IMAGE_WIRE_H
+#define RGBD_ROS_IMAGE_WIRE_H
+
+#include <string>
+
+#include <yarp/os/ConnectionReader.h>
+#include <yarp/os/ConnectionWriter.h>
+#include <yarp/os/Type.h>
+#include <yarp/os/idl/WirePortable.h>
+#include <yarp/sig/Image.h>
+#include <yarp/rosmsg/std_msgs/Header.h>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Write-only `sensor_msgs/Image` message serializing the pixels of a YARP image straight to
+ * the connection, without copying them into a `sensor_msgs::Image::data` buffer first.
+ *
+ * The message only references the image passed to setImage(): the image must not be modified
+ * or destroyed until the message has been sent, i.e. call `Publisher::waitForWrite()` before
+ * reusing it.
+ */
+class ImageWire : public yarp::os::idl::WirePortable
+{
+public:
+    yarp::rosmsg::std_msgs::Header header;
+    std::string                    encoding;
+    std::uint8_t                   is_bigendian = 0;
+
+    void setImage(const yarp::sig::Image& image);
+    const yarp::sig::Image* getImage() const;
+
+    using yarp::os::idl::WirePortable::read;
+    bool read(yarp::os::ConnectionReader& connection) override;
+    bool readBare(yarp::os::ConnectionReader& connection) override;
+    bool readBottle(yarp::os::ConnectionReader& connection) override;
+
+    bool write(yarp::os::ConnectionWriter& connection) const override;
+    bool writeBare(yarp::os::ConnectionWriter& connection) const override;
+    bool writeBottle(yarp::os::ConnectionWriter& connection) const override;
+
+    yarp::os::Type getType() const override;
+
+private:
+    const yarp::sig::Image* m_image = nullptr;
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_IMAGE_WIRE_H
@@ -5,80 +5,83 @@
 
 #include "rosPixelCode.h"
 
+#include <array>
+#include <unordered_map>
+#include <utility>
+
 namespace yarp::dev::ROSPixelCode {
 
+namespace {
+
+// ROS encoding <-> YARP pixel code table.
+// When several ROS encodings map to the same YARP pixel code, the first one is used for the
+// YARP to ROS conversion.
+constexpr std::array<std::pair<const char*, int>, 18> encodings {{
+    { RGB8,          VOCAB_PIXEL_RGB },
+    { BGR8,          VOCAB_PIXEL_BGR },
+    { RGBA8,         VOCAB_PIXEL_RGBA },
+    { BGRA8,         VOCAB_PIXEL_BGRA },
+    { MONO8,         VOCAB_PIXEL_MONO },
+    { MONO16,        VOCAB_PIXEL_MONO16 },
+    { TYPE_32FC1,    VOCAB_PIXEL_MONO_FLOAT },
+    { BAYER_BGGR16,  VOCAB_PIXEL_ENCODING_BAYER_BGGR16 },
+    { BAYER_BGGR8,   VOCAB_PIXEL_ENCODING_BAYER_BGGR8 },
+    { BAYER_GBRG16,  VOCAB_PIXEL_ENCODING_BAYER_GBRG16 },
+    { BAYER_GBRG8,   VOCAB_PIXEL_ENCODING_BAYER_GBRG8 },
+    { BAYER_GRBG16,  VOCAB_PIXEL_ENCODING_BAYER_GRBG16 },
+    { BAYER_GRBG8,   VOCAB_PIXEL_ENCODING_BAYER_GRBG8 },
+    { BAYER_RGGB16,  VOCAB_PIXEL_ENCODING_BAYER_RGGB16 },
+    { BAYER_RGGB8,   VOCAB_PIXEL_ENCODING_BAYER_RGGB8 },
+    { YUV422_YUY2,   VOCAB_PIXEL_YUV_422 },
+    // aliases, used only in the ROS to YARP direction
+    { TYPE_8UC1,     VOCAB_PIXEL_MONO },
+    { TYPE_16UC1,    VOCAB_PIXEL_MONO16 },
+}};
+
+const std::unordered_map<std::string, int>& rosToYarp()
+{
+    static const std::unordered_map<std::string, int> table = []() {
+        std::unordered_map<std::string, int> t;
+        for (const auto& e : encodings) {
+            t.emplace(e.first, e.second);
+        }
+        return t;
+    }();
+    return table;
+}
+
+const std::unordered_map<int, std::string>& yarpToRos()
+{
+    static const std::unordered_map<int, std::string> table = []() {
+        std::unordered_map<int, std::string> t;
+        for (const auto& e : encodings) {
+            t.emplace(e.second, e.first);
+        }
+        return t;
+    }();
+    return table;
+}
+
+} // namespace
+
 std::string yarp2RosPixelCode(int code)
 {
-    switch (code)
-    {
-    case VOCAB_PIXEL_BGR:
-        return BGR8;
-    case VOCAB_PIXEL_BGRA:
-        return BGRA8;
-    case VOCAB_PIXEL_ENCODING_BAYER_BGGR16:
-        return BAYER_BGGR16;
-    case VOCAB_PIXEL_ENCODING_BAYER_BGGR8:
-        return BAYER_BGGR8;
-    case VOCAB_PIXEL_ENCODING_BAYER_GBRG16:
-        return BAYER_GBRG16;
-    case VOCAB_PIXEL_ENCODING_BAYER_GBRG8:
-        return BAYER_GBRG8;
-    case VOCAB_PIXEL_ENCODING_BAYER_GRBG16:
-        return BAYER_GRBG16;
-    case VOCAB_PIXEL_ENCODING_BAYER_GRBG8:
-        return BAYER_GRBG8;
-    case VOCAB_PIXEL_ENCODING_BAYER_RGGB16:
-        return BAYER_RGGB16;
-    case VOCAB_PIXEL_ENCODING_BAYER_RGGB8:
-        return BAYER_RGGB8;
-    case VOCAB_PIXEL_MONO:
-        return MONO8;
-    case VOCAB_PIXEL_MONO16:
-        return MONO16;
-    case VOCAB_PIXEL_RGB:
-        return RGB8;
-    case VOCAB_PIXEL_RGBA:
-        return RGBA8;
-    case VOCAB_PIXEL_MONO_FLOAT:
-        return TYPE_32FC1;
-    default:
+    const auto& table = yarpToRos();
+    auto it = table.find(code);
+    if (it == table.end()) {
         return RGB8;
     }
+    return it->second;
 }
 
 int Ros2YarpPixelCode(const std::string& roscode)
 {
-    if (roscode == BGR8) {
-        return VOCAB_PIXEL_BGR;
-    } else if (roscode == BGRA8) {
-        return VOCAB_PIXEL_BGRA;
-    } else if (roscode == BAYER_BGGR8) {
-        return VOCAB_PIXEL_ENCODING_BAYER_BGGR8;
-    } else if (roscode == BAYER_GBRG16) {
-        return VOCAB_PIXEL_ENCODING_BAYER_GBRG16;
-    } else if (roscode == BAYER_GBRG8) {
-        return VOCAB_PIXEL_ENCODING_BAYER_GBRG8;
-    } else if (roscode == BAYER_GRBG16) {
-        return VOCAB_PIXEL_ENCODING_BAYER_GRBG16;
-    } else if (roscode == BAYER_GRBG8) {
-        return VOCAB_PIXEL_ENCODING_BAYER_GRBG8;
-    } else if (roscode == BAYER_RGGB16) {
-        return VOCAB_PIXEL_ENCODING_BAYER_RGGB16;
-    } else if (roscode == BAYER_RGGB8) {
-        return VOCAB_PIXEL_ENCODING_BAYER_RGGB8;
-    } else if (roscode == MONO8) {
-        return VOCAB_PIXEL_MONO;
-    } else if (roscode == MONO16) {
-        return VOCAB_PIXEL_MONO16;
-    } else if (roscode == RGB8) {
-        return VOCAB_PIXEL_RGB;
-    } else if (roscode == RGBA8) {
-        return VOCAB_PIXEL_RGBA;
-    } else if (roscode == TYPE_32FC1) {
-        return VOCAB_PIXEL_MONO_FLOAT;
-    } else {
+    const auto& table = rosToYarp();
+    auto it = table.find(roscode);
+    if (it == table.end()) {
         return VOCAB_PIXEL_INVALID;
     }
+    return it->second;
 }
 
 } // namespace yarp::dev::ROSPixelCode
@@ -58,9 +58,19 @@ namespace yarp::dev::ROSPixelCode {
 #define TYPE_8UC3    "8UC3"
 #define TYPE_8UC4    "8UC4"
 #define YUV422       "yuv422"
+#define YUV422_YUY2  "yuv422_yuy2"
 
+/**
+ * Returns the ROS encoding matching a YARP pixel code (`rgb8` if the pixel code has no ROS equivalent).
+ */
 std::string yarp2RosPixelCode(int code);
 
+/**
+ * Returns the YARP pixel code matching a ROS encoding (`VOCAB_PIXEL_INVALID` if unsupported).
+ * Both `16UC1` and `mono16` map to `VOCAB_PIXEL_MONO16`, both `8UC1` and `mono8` to `VOCAB_PIXEL_MONO`.
+ * Note that ROS `yuv422` is UYVY ordered and has no YARP equivalent, YARP `VOCAB_PIXEL_YUV_422`
+ * (YUYV ordered) maps to `yuv422_yuy2`.
+ */
 int Ros2YarpPixelCode(const std::string& roscode);
 
 } // namespace yarp::dev::ROSPixelCode
@@ -0,0 +1,157 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <depthConversion.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <harness.h>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+// lengths around the vector widths, to run both the SIMD loops and the scalar tails
+const std::size_t lengths[] = {0, 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 127, 1001};
+
+const SimdPath depthPaths[] = {SimdPath::Scalar, SimdPath::Sse2, SimdPath::Avx2, SimdPath::Neon};
+
+bool sameBits(float a, float b)
+{
+    std::uint32_t x;
+    std::uint32_t y;
+    memcpy(&x, &a, sizeof(x));
+    memcpy(&y, &b, sizeof(y));
+    return x == y;
+}
+
+// the REP 118 conversion: rounded to nearest, 0 for the values that do not fit [1, 65535]
+std::uint16_t expectedDepth16U(float v, float scale)
+{
+    const double scaled = static_cast<double>(static_cast<float>(v * scale) + 0.5f);
+    return (scaled >= 1.0 && scaled < 65536.0) ? static_cast<std::uint16_t>(scaled) : 0;
+}
+
+} // namespace
+
+TEST_CASE("dev::RGBDRosConversionUtils::depth16UToFloat", "[yarp::dev]")
+{
+    std::mt19937 rng(42);
+    std::vector<std::uint16_t> src(1001);
+    for (auto& v : src) {
+        v = static_cast<std::uint16_t>(rng());
+    }
+    // no measurement, full scale and values whose bytes differ
+    src[0] = 0;
+    src[1] = 65535;
+    src[2] = 0x00FF;
+    src[3] = 0xFF00;
+    src[4] = 0x1234;
+
+    for (SimdPath path : depthPaths) {
+        if (!convertDepth16UToFloatWith(path, src.data(), nullptr, 0, 1.0f, false)) {
+            // not compiled in or not supported by this CPU
+            continue;
+        }
+        for (bool swapBytes : {false, true}) {
+            for (float scale : {0.001f, 1.0f, 0.125f}) {
+                for (std::size_t count : lengths) {
+                    INFO("path " << static_cast<int>(path) << ", swap " << swapBytes << ", scale " << scale << ", count " << count);
+                    // a guard sample after the last one, that must not be written
+                    std::vector<float> dst(count + 1, -1.0f);
+                    REQUIRE(convertDepth16UToFloatWith(path, src.data(), dst.data(), count, scale, swapBytes));
+                    bool same = true;
+                    for (std::size_t i = 0; i < count; i++) {
+                        std::uint16_t v = src[i];
+                        if (swapBytes) {
+                            v = static_cast<std::uint16_t>((v << 8) | (v >> 8));
+                        }
+                        same = same && sameBits(dst[i], static_cast<float>(v) * scale);
+                    }
+                    CHECK(same);
+                    CHECK(dst[count] == -1.0f);
+                }
+            }
+        }
+    }
+
+    // the runtime dispatch agrees with the scalar kernel too
+    std::vector<float> dispatched(src.size());
+    std::vector<float> scalar(src.size());
+    convertDepth16UToFloat(src.data(), dispatched.data(), src.size(), DEFAULT_DEPTH_SCALE, true);
+    REQUIRE(convertDepth16UToFloatWith(SimdPath::Scalar, src.data(), scalar.data(), src.size(), DEFAULT_DEPTH_SCALE, true));
+    CHECK(memcmp(dispatched.data(), scalar.data(), src.size() * sizeof(float)) == 0);
+
+    // paths that have no depth kernel
+    CHECK_FALSE(convertDepth16UToFloatWith(SimdPath::Ssse3, src.data(), scalar.data(), 1, 1.0f, false));
+}
+
+TEST_CASE("dev::RGBDRosConversionUtils::floatDepthTo16U", "[yarp::dev]")
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    std::mt19937 rng(43);
+    std::uniform_real_distribution<float> metres(-0.5f, 70.0f);
+    std::vector<float> src(1001);
+    for (auto& v : src) {
+        v = metres(rng);
+    }
+    // special values, spread so that they fall in both the vector lanes and the tails
+    const float special[] = {nan, inf, -inf, -1.0f, -0.0f, 0.0f, 0.0004f, 0.0005f, 0.0015f, 65.5345f, 65.5355f, 65.5365f,
+                             1e30f, -1e30f, std::numeric_limits<float>::denorm_min(), -nan};
+    for (std::size_t i = 0; i < src.size(); i += 7) {
+        src[i] = special[(i / 7) % (sizeof(special) / sizeof(special[0]))];
+    }
+
+    for (SimdPath path : depthPaths) {
+        if (!convertFloatDepthTo16UWith(path, src.data(), nullptr, 0, 1000.0f)) {
+            // not compiled in or not supported by this CPU
+            continue;
+        }
+        for (float scale : {1000.0f, 1.0f}) {
+            for (std::size_t count : lengths) {
+                INFO("path " << static_cast<int>(path) << ", scale " << scale << ", count " << count);
+                std::vector<std::uint16_t> dst(count + 1, 0xBEEF);
+                REQUIRE(convertFloatDepthTo16UWith(path, src.data(), dst.data(), count, scale));
+                bool same = true;
+                for (std::size_t i = 0; i < count; i++) {
+                    same = same && dst[i] == expectedDepth16U(src[i], scale);
+                }
+                CHECK(same);
+                CHECK(dst[count] == 0xBEEF);
+            }
+        }
+
+        // the limits, each one in a full vector and in the tail
+        const float values[] = {nan, inf, -inf, -2.0f, 0.0f, 0.4f, 0.5f, 65534.5f, 65535.0f, 65535.4f, 65535.5f, 70000.0f};
+        const std::uint16_t expected[] = {0, 0, 0, 0, 0, 0, 1, 65535, 65535, 65535, 0, 0};
+        for (std::size_t k = 0; k < sizeof(values) / sizeof(values[0]); k++) {
+            INFO("path " << static_cast<int>(path) << ", value " << values[k]);
+            std::vector<float> in(19, values[k]);
+            std::vector<std::uint16_t> out(in.size(), 0xBEEF);
+            REQUIRE(convertFloatDepthTo16UWith(path, in.data(), out.data(), in.size(), 1.0f));
+            bool same = true;
+            for (std::uint16_t v : out) {
+                same = same && v == expected[k];
+            }
+            CHECK(same);
+        }
+    }
+
+    // the runtime dispatch agrees with the scalar kernel too
+    std::vector<std::uint16_t> dispatched(src.size());
+    std::vector<std::uint16_t> scalar(src.size());
+    convertFloatDepthTo16U(src.data(), dispatched.data(), src.size(), 1000.0f);
+    REQUIRE(convertFloatDepthTo16UWith(SimdPath::Scalar, src.data(), scalar.data(), src.size(), 1000.0f));
+    CHECK(dispatched == scalar);
+
+    CHECK_FALSE(convertFloatDepthTo16UWith(SimdPath::Ssse3, src.data(), scalar.data(), 1, 1.0f));
+}
@@ -0,0 +1,226 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pixelConversion.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <harness.h>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+const SimdPath pixelPaths[] = {SimdPath::Scalar, SimdPath::Ssse3, SimdPath::Neon};
+
+const BayerPattern bayerPatterns[] = {BayerPattern::RGGB, BayerPattern::BGGR, BayerPattern::GRBG, BayerPattern::GBRG};
+
+typedef bool (*PixelConversion)(SimdPath, const std::uint8_t*, std::uint8_t*, std::size_t);
+
+// Runs `conversion` with every available path on lengths around the vector widths, comparing the output
+// with the channels `order` of the `srcChannels` byte source pixels
+void checkPixelConversion(PixelConversion conversion, std::size_t srcChannels, const int (&order)[3])
+{
+    std::mt19937 rng(7);
+    std::vector<std::uint8_t> src(srcChannels * 200);
+    for (auto& v : src) {
+        v = static_cast<std::uint8_t>(rng());
+    }
+
+    for (SimdPath path : pixelPaths) {
+        if (!conversion(path, src.data(), nullptr, 0)) {
+            // not compiled in or not supported by this CPU
+            continue;
+        }
+        for (std::size_t count = 0; count < 200; count += (count < 40 ? 1 : 23)) {
+            INFO("path " << static_cast<int>(path) << ", count " << count);
+            // guard bytes after the last pixel, that must not be written
+            std::vector<std::uint8_t> dst(3 * count + 16, 0xA5);
+            REQUIRE(conversion(path, src.data(), dst.data(), count));
+            bool same = true;
+            for (std::size_t i = 0; i < count; i++) {
+                for (std::size_t c = 0; c < 3; c++) {
+                    same = same && dst[3 * i + c] == src[srcChannels * i + order[c]];
+                }
+            }
+            CHECK(same);
+            bool guarded = true;
+            for (std::size_t i = 3 * count; i < dst.size(); i++) {
+                guarded = guarded && dst[i] == 0xA5;
+            }
+            CHECK(guarded);
+        }
+    }
+}
+
+// Colour (0 red, 1 green, 2 blue) of the sample (x, y) of a `pattern` Bayer image
+int bayerColour(BayerPattern pattern, std::size_t x, std::size_t y)
+{
+    switch (bayerPatternAt(pattern, x, y)) {
+    case BayerPattern::RGGB: return 0;
+    case BayerPattern::BGGR: return 2;
+    default: return 1;
+    }
+}
+
+// Straightforward bilinear demosaicing, one pixel at a time, with the borders mirrored
+std::vector<std::uint8_t> referenceDemosaic(const std::vector<std::uint8_t>& src, std::size_t width, std::size_t height, BayerPattern pattern)
+{
+    auto at = [&](std::ptrdiff_t x, std::ptrdiff_t y) {
+        const auto w = static_cast<std::ptrdiff_t>(width);
+        const auto h = static_cast<std::ptrdiff_t>(height);
+        x = x < 0 ? (w > 1 ? 1 : 0) : (x >= w ? (w > 1 ? w - 2 : w - 1) : x);
+        y = y < 0 ? (h > 1 ? 1 : 0) : (y >= h ? (h > 1 ? h - 2 : h - 1) : y);
+        return static_cast<int>(src[static_cast<std::size_t>(y) * width + static_cast<std::size_t>(x)]);
+    };
+    std::vector<std::uint8_t> rgb(3 * width * height);
+    for (std::size_t y = 0; y < height; y++) {
+        for (std::size_t x = 0; x < width; x++) {
+            const auto ix = static_cast<std::ptrdiff_t>(x);
+            const auto iy = static_cast<std::ptrdiff_t>(y);
+            std::uint8_t* px = rgb.data() + 3 * (y * width + x);
+            const int colour = bayerColour(pattern, x, y);
+            if (colour != 1) {
+                px[colour] = static_cast<std::uint8_t>(at(ix, iy));
+                px[1] = static_cast<std::uint8_t>((at(ix - 1, iy) + at(ix + 1, iy) + at(ix, iy - 1) + at(ix, iy + 1) + 2) >> 2);
+                px[2 - colour] = static_cast<std::uint8_t>((at(ix - 1, iy - 1) + at(ix + 1, iy - 1) + at(ix - 1, iy + 1) + at(ix + 1, iy + 1) + 2) >> 2);
+            } else {
+                // the horizontal neighbours have the colour of the row
+                const int rowColour = bayerColour(pattern, x + 1, y);
+                px[1] = static_cast<std::uint8_t>(at(ix, iy));
+                px[rowColour] = static_cast<std::uint8_t>((at(ix - 1, iy) + at(ix + 1, iy) + 1) >> 1);
+                px[2 - rowColour] = static_cast<std::uint8_t>((at(ix, iy - 1) + at(ix, iy + 1) + 1) >> 1);
+            }
+        }
+    }
+    return rgb;
+}
+
+} // namespace
+
+TEST_CASE("dev::RGBDRosConversionUtils::convertBgrToRgb", "[yarp::dev]")
+{
+    checkPixelConversion(convertBgrToRgbWith, 3, {2, 1, 0});
+}
+
+TEST_CASE("dev::RGBDRosConversionUtils::convertRgbaToRgb", "[yarp::dev]")
+{
+    checkPixelConversion(convertRgbaToRgbWith, 4, {0, 1, 2});
+}
+
+TEST_CASE("dev::RGBDRosConversionUtils::convertBgraToRgb", "[yarp::dev]")
+{
+    checkPixelConversion(convertBgraToRgbWith, 4, {2, 1, 0});
+}
+
+TEST_CASE("dev::RGBDRosConversionUtils::demosaicBayer8", "[yarp::dev]")
+{
+    std::mt19937 rng(11);
+    const std::size_t sizes[][2] = {{1, 1}, {2, 1}, {1, 3}, {2, 2}, {3, 3}, {5, 4}, {8, 7}, {17, 9}};
+
+    for (BayerPattern pattern : bayerPatterns) {
+        for (const auto& size : sizes) {
+            const std::size_t width = size[0];
+            const std::size_t height = size[1];
+            std::vector<std::uint8_t> src(width * height);
+            for (auto& v : src) {
+                v = static_cast<std::uint8_t>(rng());
+            }
+            const std::vector<std::uint8_t> expected = referenceDemosaic(src, width, height, pattern);
+
+            for (bool bgrOutput : {false, true}) {
+                INFO("pattern " << static_cast<int>(pattern) << ", " << width << "x" << height << ", bgr " << bgrOutput);
+                // padded destination rows, the padding must not be written
+                const std::size_t dstStep = 3 * width + 5;
+                std::vector<std::uint8_t> dst(dstStep * height, 0xA5);
+                demosaicBayer8(src.data(), width, dst.data(), dstStep, width, height, pattern, bgrOutput);
+                bool same = true;
+                bool guarded = true;
+                for (std::size_t y = 0; y < height; y++) {
+                    for (std::size_t x = 0; x < width; x++) {
+                        for (std::size_t c = 0; c < 3; c++) {
+                            const std::size_t out = bgrOutput ? 2 - c : c;
+                            same = same && dst[y * dstStep + 3 * x + out] == expected[3 * (y * width + x) + c];
+                        }
+                    }
+                    for (std::size_t i = 3 * width; i < dstStep; i++) {
+                        guarded = guarded && dst[y * dstStep + i] == 0xA5;
+                    }
+                }
+                CHECK(same);
+                CHECK(guarded);
+            }
+        }
+    }
+
+    // a mosaic of a flat colour gives back that colour everywhere, borders included
+    for (BayerPattern pattern : bayerPatterns) {
+        const std::size_t width = 9;
+        const std::size_t height = 6;
+        const std::uint8_t colour[3] = {200, 90, 30};
+        std::vector<std::uint8_t> src(width * height);
+        for (std::size_t y = 0; y < height; y++) {
+            for (std::size_t x = 0; x < width; x++) {
+                src[y * width + x] = colour[bayerColour(pattern, x, y)];
+            }
+        }
+        std::vector<std::uint8_t> dst(3 * width * height);
+        demosaicBayer8(src.data(), width, dst.data(), 3 * width, width, height, pattern, false);
+        bool flat = true;
+        for (std::size_t i = 0; i < width * height; i++) {
+            flat = flat && dst[3 * i] == colour[0] && dst[3 * i + 1] == colour[1] && dst[3 * i + 2] == colour[2];
+        }
+        CHECK(flat);
+    }
+}
+
+TEST_CASE("dev::RGBDRosConversionUtils::binBayer8", "[yarp::dev]")
+{
+    std::mt19937 rng(13);
+    for (BayerPattern pattern : bayerPatterns) {
+        for (std::size_t decimation : {2, 3, 4, 5}) {
+            for (bool bgrOutput : {false, true}) {
+                INFO("pattern " << static_cast<int>(pattern) << ", decimation " << decimation << ", bgr " << bgrOutput);
+                const std::size_t outWidth = 7;
+                const std::size_t outHeight = 5;
+                const std::size_t srcStep = outWidth * decimation + 1;
+                std::vector<std::uint8_t> src(srcStep * outHeight * decimation);
+                for (auto& v : src) {
+                    v = static_cast<std::uint8_t>(rng());
+                }
+                const std::size_t dstStep = 3 * outWidth + 2;
+                std::vector<std::uint8_t> dst(dstStep * outHeight, 0xA5);
+                binBayer8(src.data(), srcStep, dst.data(), dstStep, outWidth, outHeight, decimation, pattern, bgrOutput);
+
+                bool same = true;
+                bool guarded = true;
+                for (std::size_t r = 0; r < outHeight; r++) {
+                    for (std::size_t c = 0; c < outWidth; c++) {
+                        // the 2x2 cell at even coordinates nearest to (c, r) * decimation
+                        const std::size_t x0 = (c * decimation) / 2 * 2;
+                        const std::size_t y0 = (r * decimation) / 2 * 2;
+                        int sum[3] = {0, 0, 0};
+                        for (std::size_t y = y0; y < y0 + 2; y++) {
+                            for (std::size_t x = x0; x < x0 + 2; x++) {
+                                sum[bayerColour(pattern, x, y)] += src[y * srcStep + x];
+                            }
+                        }
+                        const int expected[3] = {sum[0], (sum[1] + 1) / 2, sum[2]};
+                        for (std::size_t ch = 0; ch < 3; ch++) {
+                            const std::size_t out = bgrOutput ? 2 - ch : ch;
+                            same = same && dst[r * dstStep + 3 * c + out] == expected[ch];
+                        }
+                    }
+                    guarded = guarded && dst[r * dstStep + 3 * outWidth] == 0xA5 && dst[r * dstStep + 3 * outWidth + 1] == 0xA5;
+                }
+                CHECK(same);
+                CHECK(guarded);
+            }
+        }
+    }
+}
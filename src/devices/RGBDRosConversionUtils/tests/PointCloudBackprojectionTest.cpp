@@ -0,0 +1,189 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pointCloudBackprojection.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <harness.h>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+// Expected point of the image pixel (u, v), computed one pixel at a time as the documentation describes it
+void referencePoint(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth,
+                    const yarp::sig::Image& color,
+                    const yarp::sig::IntrinsicParams& intrinsics,
+                    const BackprojectionFilter& filter,
+                    std::size_t u,
+                    std::size_t v,
+                    bool& valid,
+                    unsigned char* point)
+{
+    float d;
+    memcpy(&d, depth.getRow(v) + u * sizeof(float), sizeof(d));
+    valid = std::isfinite(d) && d > 0.0f
+            && (filter.minDepth <= 0.0f || d >= filter.minDepth)
+            && (filter.maxDepth <= 0.0f || d <= filter.maxDepth);
+
+    float xyz[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    if (valid) {
+        const auto column = static_cast<float>((static_cast<double>(u) - intrinsics.principalPointX) / intrinsics.focalLengthX);
+        const auto row = static_cast<float>((static_cast<double>(v) - intrinsics.principalPointY) / intrinsics.focalLengthY);
+        xyz[0] = column * d;
+        xyz[1] = row * d;
+        xyz[2] = d;
+    } else {
+        xyz[0] = xyz[1] = xyz[2] = std::numeric_limits<float>::quiet_NaN();
+    }
+    memset(point, 0, POINT_XYZRGB_STEP);
+    memcpy(point, xyz, sizeof(xyz));
+
+    const unsigned char* c = color.getRow(v) + u * color.getPixelSize();
+    unsigned char* bgra = point + POINT_XYZRGB_RGB_OFFSET;
+    switch (color.getPixelCode()) {
+    case VOCAB_PIXEL_MONO:
+        bgra[0] = bgra[1] = bgra[2] = c[0];
+        break;
+    case VOCAB_PIXEL_RGB:
+    case VOCAB_PIXEL_RGBA:
+        bgra[0] = c[2];
+        bgra[1] = c[1];
+        bgra[2] = c[0];
+        break;
+    default:
+        bgra[0] = c[0];
+        bgra[1] = c[1];
+        bgra[2] = c[2];
+        break;
+    }
+    bgra[3] = 255;
+}
+
+// Same bytes, but all NaN coordinates compare equal whatever their payload
+bool samePoint(const unsigned char* a, const unsigned char* b)
+{
+    float pa[3];
+    float pb[3];
+    memcpy(pa, a, sizeof(pa));
+    memcpy(pb, b, sizeof(pb));
+    for (std::size_t k = 0; k < 3; k++) {
+        if (std::isnan(pa[k]) != std::isnan(pb[k]) || (!std::isnan(pa[k]) && pa[k] != pb[k])) {
+            return false;
+        }
+    }
+    return memcmp(a + sizeof(pa), b + sizeof(pb), POINT_XYZRGB_STEP - sizeof(pa)) == 0;
+}
+
+} // namespace
+
+TEST_CASE("dev::RGBDRosConversionUtils::backprojectRows", "[yarp::dev]")
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    std::mt19937 rng(17);
+
+    for (int pixelCode : {VOCAB_PIXEL_MONO, VOCAB_PIXEL_RGB, VOCAB_PIXEL_BGR, VOCAB_PIXEL_RGBA, VOCAB_PIXEL_BGRA}) {
+        REQUIRE(isBackprojectionSupported(pixelCode));
+        // widths that are not a multiple of the 4 points of the vector loop, and one that is
+        for (std::size_t width : {1, 7, 13, 16}) {
+            const std::size_t height = 9;
+            yarp::sig::ImageOf<yarp::sig::PixelFloat> depth;
+            depth.resize(width, height);
+            yarp::sig::FlexImage color;
+            color.setPixelCode(pixelCode);
+            color.resize(width, height);
+            for (std::size_t v = 0; v < height; v++) {
+                unsigned char* c = color.getRow(v);
+                for (std::size_t i = 0; i < width * color.getPixelSize(); i++) {
+                    c[i] = static_cast<unsigned char>(rng());
+                }
+                for (std::size_t u = 0; u < width; u++) {
+                    const float special[] = {nan, 0.0f, -1.0f, inf, 0.999f, 1.0f, 3.5f, 3.501f};
+                    const std::uint32_t k = rng() % 16;
+                    const float d = k < 8 ? special[k] : 0.01f + static_cast<float>(rng() % 5000) / 1000.0f;
+                    memcpy(depth.getRow(v) + u * sizeof(float), &d, sizeof(d));
+                }
+            }
+
+            yarp::sig::IntrinsicParams intrinsics;
+            intrinsics.focalLengthX = 500.0;
+            intrinsics.focalLengthY = 510.0;
+            intrinsics.principalPointX = width / 2.0;
+            intrinsics.principalPointY = 2.3;
+
+            for (std::size_t stride : {1, 3}) {
+                RayTable rays;
+                rays.update(intrinsics, width, height, stride);
+                const std::size_t columns = (width + stride - 1) / stride;
+                const std::size_t rows = (height + stride - 1) / stride;
+                REQUIRE(rays.width() == columns);
+                REQUIRE(rays.height() == rows);
+
+                for (bool clip : {false, true}) {
+                    for (bool removeInvalid : {false, true}) {
+                        INFO("pixel code " << pixelCode << ", width " << width << ", stride " << stride
+                                           << ", clip " << clip << ", removeInvalid " << removeInvalid);
+                        BackprojectionFilter filter;
+                        filter.removeInvalid = removeInvalid;
+                        if (clip) {
+                            filter.minDepth = 1.0f;
+                            filter.maxDepth = 3.5f;
+                        }
+
+                        // reference cloud, and the valid points of each row
+                        std::vector<unsigned char> expected;
+                        std::vector<std::size_t> validPerRow(rows, 0);
+                        unsigned char point[POINT_XYZRGB_STEP];
+                        for (std::size_t j = 0; j < rows; j++) {
+                            for (std::size_t i = 0; i < columns; i++) {
+                                bool valid = false;
+                                referencePoint(depth, color, intrinsics, filter, i * stride, j * stride, valid, point);
+                                if (valid) {
+                                    validPerRow[j]++;
+                                }
+                                if (valid || !removeInvalid) {
+                                    expected.insert(expected.end(), point, point + POINT_XYZRGB_STEP);
+                                }
+                            }
+                        }
+
+                        std::vector<std::size_t> rowOffsets(rows + 1, 0);
+                        for (std::size_t j = 0; j < rows; j++) {
+                            CHECK(countValidPoints(depth, rays, filter, j) == validPerRow[j]);
+                            rowOffsets[j + 1] = rowOffsets[j] + countValidPoints(depth, rays, filter, j);
+                        }
+                        const std::size_t points = removeInvalid ? rowOffsets[rows] : columns * rows;
+                        REQUIRE(points * POINT_XYZRGB_STEP == expected.size());
+
+                        // two disjoint row ranges, as the worker pool does, and guard bytes after the cloud
+                        std::vector<unsigned char> cloud((points + 1) * POINT_XYZRGB_STEP, 0xCD);
+                        const std::size_t half = rows / 2;
+                        backprojectRows(depth, color, rays, filter, half, rows, cloud.data(), rowOffsets.data());
+                        backprojectRows(depth, color, rays, filter, 0, half, cloud.data(), rowOffsets.data());
+
+                        bool same = true;
+                        for (std::size_t p = 0; p < points; p++) {
+                            same = same && samePoint(cloud.data() + p * POINT_XYZRGB_STEP, expected.data() + p * POINT_XYZRGB_STEP);
+                        }
+                        CHECK(same);
+                        bool guarded = true;
+                        for (std::size_t k = points * POINT_XYZRGB_STEP; k < cloud.size(); k++) {
+                            guarded = guarded && cloud[k] == 0xCD;
+                        }
+                        CHECK(guarded);
+                    }
+                }
+            }
+        }
+    }
+}
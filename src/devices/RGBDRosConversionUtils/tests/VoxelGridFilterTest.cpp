@@ -0,0 +1,231 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <pointCloudBackprojection.h>
+#include <voxelGridFilter.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <harness.h>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+// access to the generation counter of a filter, to reach its wrap around
+class VoxelGridFilterTest
+{
+public:
+    static std::uint32_t generation(const VoxelGridFilter& filter) { return filter.m_generation; }
+    static void setGeneration(VoxelGridFilter& filter, std::uint32_t generation) { filter.m_generation = generation; }
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+namespace {
+
+struct ReferenceVoxel
+{
+    double        sum[3];
+    unsigned      colorSum[3];
+    unsigned      count;
+    float         first[3];
+    std::uint32_t firstRgb;
+};
+
+struct Cloud
+{
+    std::vector<std::uint8_t> points;
+    std::size_t               count = 0;
+
+    void add(float x, float y, float z, const unsigned char (&bgr)[3])
+    {
+        unsigned char point[POINT_XYZRGB_STEP] = {};
+        const float xyz[4] = {x, y, z, 0.0f};
+        memcpy(point, xyz, sizeof(xyz));
+        point[POINT_XYZRGB_RGB_OFFSET] = bgr[0];
+        point[POINT_XYZRGB_RGB_OFFSET + 1] = bgr[1];
+        point[POINT_XYZRGB_RGB_OFFSET + 2] = bgr[2];
+        point[POINT_XYZRGB_RGB_OFFSET + 3] = 255;
+        points.insert(points.end(), point, point + POINT_XYZRGB_STEP);
+        count++;
+    }
+};
+
+// Filters `cloud` with an ordered map keyed by voxel index, and compares it with `filter`
+void checkFilter(VoxelGridFilter& filter, VoxelGridFilter::Policy policy, double leafSize, const Cloud& cloud)
+{
+    typedef std::tuple<long, long, long> Key;
+    std::map<Key, ReferenceVoxel> voxels;
+    std::vector<Key> order;
+    const double inverseLeaf = 1.0 / leafSize;
+    for (std::size_t p = 0; p < cloud.count; p++) {
+        const unsigned char* point = cloud.points.data() + p * POINT_XYZRGB_STEP;
+        float xyz[3];
+        memcpy(xyz, point, sizeof(xyz));
+        if (std::isnan(xyz[0]) || std::isnan(xyz[1]) || std::isnan(xyz[2])) {
+            continue;
+        }
+        const Key key(static_cast<long>(std::floor(xyz[0] * inverseLeaf)),
+                      static_cast<long>(std::floor(xyz[1] * inverseLeaf)),
+                      static_cast<long>(std::floor(xyz[2] * inverseLeaf)));
+        const unsigned char* bgra = point + POINT_XYZRGB_RGB_OFFSET;
+        auto it = voxels.find(key);
+        if (it == voxels.end()) {
+            ReferenceVoxel voxel = {{0, 0, 0}, {0, 0, 0}, 0, {xyz[0], xyz[1], xyz[2]}, 0};
+            memcpy(&voxel.firstRgb, bgra, sizeof(voxel.firstRgb));
+            it = voxels.emplace(key, voxel).first;
+            order.push_back(key);
+        }
+        ReferenceVoxel& voxel = it->second;
+        for (std::size_t k = 0; k < 3; k++) {
+            voxel.sum[k] += xyz[k];
+            voxel.colorSum[k] += bgra[k];
+        }
+        voxel.count++;
+    }
+
+    std::vector<std::uint8_t> out;
+    const std::size_t count = filter.filter(cloud.points.data(), cloud.count, out);
+    REQUIRE(count == order.size());
+    REQUIRE(out.size() == count * POINT_XYZRGB_STEP);
+
+    bool same = true;
+    for (std::size_t i = 0; i < count; i++) {
+        const ReferenceVoxel& voxel = voxels[order[i]];
+        const unsigned char* point = out.data() + i * POINT_XYZRGB_STEP;
+        float xyz[4];
+        memcpy(xyz, point, sizeof(xyz));
+        const unsigned char* bgra = point + POINT_XYZRGB_RGB_OFFSET;
+        if (policy == VoxelGridFilter::Policy::First) {
+            std::uint32_t rgb;
+            memcpy(&rgb, bgra, sizeof(rgb));
+            same = same && xyz[0] == voxel.first[0] && xyz[1] == voxel.first[1] && xyz[2] == voxel.first[2] && rgb == voxel.firstRgb;
+        } else {
+            for (std::size_t k = 0; k < 3; k++) {
+                same = same && xyz[k] == static_cast<float>(voxel.sum[k] / voxel.count);
+                same = same && bgra[k] == (voxel.colorSum[k] + voxel.count / 2) / voxel.count;
+            }
+            same = same && bgra[3] == 255;
+        }
+        same = same && xyz[3] == 0.0f;
+        for (std::size_t k = POINT_XYZRGB_RGB_OFFSET + 4; k < POINT_XYZRGB_STEP; k++) {
+            same = same && point[k] == 0;
+        }
+    }
+    CHECK(same);
+}
+
+// `count` points spread over a `extent` metres cube, a tenth of them NaN
+Cloud randomCloud(std::mt19937& rng, std::size_t count, float extent)
+{
+    std::uniform_real_distribution<float> coordinate(-extent / 2, extent / 2);
+    Cloud cloud;
+    for (std::size_t p = 0; p < count; p++) {
+        const unsigned char bgr[3] = {static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng()), static_cast<unsigned char>(rng())};
+        if (rng() % 10 == 0) {
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            cloud.add(nan, nan, nan, bgr);
+        } else {
+            cloud.add(coordinate(rng), coordinate(rng), coordinate(rng) + extent, bgr);
+        }
+    }
+    return cloud;
+}
+
+const VoxelGridFilter::Policy policies[] = {VoxelGridFilter::Policy::Centroid, VoxelGridFilter::Policy::First};
+
+} // namespace
+
+TEST_CASE("dev::RGBDRosConversionUtils::VoxelGridFilter", "[yarp::dev]")
+{
+    SECTION("Centroid and first point of each voxel")
+    {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        Cloud cloud;
+        cloud.add(0.10f, 0.10f, 1.10f, {10, 20, 30});
+        cloud.add(nan, 0.10f, 1.10f, {200, 200, 200});
+        cloud.add(0.30f, 0.20f, 1.40f, {20, 40, 61});
+        cloud.add(-0.10f, 0.10f, 1.10f, {1, 2, 3});
+        cloud.add(0.40f, 0.45f, 1.30f, {30, 60, 90});
+        cloud.add(0.10f, nan, nan, {200, 200, 200});
+
+        std::vector<std::uint8_t> out;
+        VoxelGridFilter centroid(0.5, VoxelGridFilter::Policy::Centroid);
+        REQUIRE(centroid.filter(cloud.points.data(), cloud.count, out) == 2);
+        float xyz[3];
+        memcpy(xyz, out.data(), sizeof(xyz));
+        // accumulated in double, as the filter does
+        CHECK(xyz[0] == static_cast<float>((static_cast<double>(0.10f) + 0.30f + 0.40f) / 3));
+        CHECK(xyz[1] == static_cast<float>((static_cast<double>(0.10f) + 0.20f + 0.45f) / 3));
+        CHECK(xyz[2] == static_cast<float>((static_cast<double>(1.10f) + 1.40f + 1.30f) / 3));
+        // (10 + 20 + 30) / 3, (20 + 40 + 60) / 3 and (30 + 61 + 90) / 3 rounded
+        CHECK(out[POINT_XYZRGB_RGB_OFFSET] == 20);
+        CHECK(out[POINT_XYZRGB_RGB_OFFSET + 1] == 40);
+        CHECK(out[POINT_XYZRGB_RGB_OFFSET + 2] == 60);
+        memcpy(xyz, out.data() + POINT_XYZRGB_STEP, sizeof(xyz));
+        CHECK(xyz[0] == -0.10f);
+        CHECK(out[POINT_XYZRGB_STEP + POINT_XYZRGB_RGB_OFFSET] == 1);
+
+        VoxelGridFilter first(0.5, VoxelGridFilter::Policy::First);
+        REQUIRE(first.filter(cloud.points.data(), cloud.count, out) == 2);
+        memcpy(xyz, out.data(), sizeof(xyz));
+        CHECK(xyz[0] == 0.10f);
+        CHECK(xyz[1] == 0.10f);
+        CHECK(xyz[2] == 1.10f);
+        CHECK(out[POINT_XYZRGB_RGB_OFFSET] == 10);
+        CHECK(out[POINT_XYZRGB_RGB_OFFSET + 2] == 30);
+
+        // only NaN points
+        Cloud invalid;
+        invalid.add(nan, nan, nan, {0, 0, 0});
+        CHECK(first.filter(invalid.points.data(), invalid.count, out) == 0);
+        CHECK(out.empty());
+    }
+
+    SECTION("Against a reference, growing the table past half load and reusing it")
+    {
+        std::mt19937 rng(19);
+        for (VoxelGridFilter::Policy policy : policies) {
+            INFO("policy " << static_cast<int>(policy));
+            VoxelGridFilter filter(0.05, policy);
+            // the first table has 4096 slots: the larger clouds hit thousands of voxels and force the rehashes,
+            // the following smaller ones run on the grown table
+            for (std::size_t count : {1000, 20000, 80000, 500, 30000}) {
+                checkFilter(filter, policy, 0.05, randomCloud(rng, count, 2.0f));
+            }
+        }
+    }
+
+    SECTION("Generation wrap around")
+    {
+        std::mt19937 rng(23);
+        for (VoxelGridFilter::Policy policy : policies) {
+            INFO("policy " << static_cast<int>(policy));
+            VoxelGridFilter filter(0.1, policy);
+            const Cloud cloud = randomCloud(rng, 5000, 1.0f);
+            checkFilter(filter, policy, 0.1, cloud);
+            REQUIRE(VoxelGridFilterTest::generation(filter) == 1);
+
+            // the slots written above are stamped with generation 1: after the wrap they would be taken as
+            // current again unless the table is cleared
+            VoxelGridFilterTest::setGeneration(filter, std::numeric_limits<std::uint32_t>::max() - 1);
+            checkFilter(filter, policy, 0.1, randomCloud(rng, 3000, 1.0f));
+            CHECK(VoxelGridFilterTest::generation(filter) == std::numeric_limits<std::uint32_t>::max());
+            checkFilter(filter, policy, 0.1, cloud);
+            CHECK(VoxelGridFilterTest::generation(filter) == 1);
+            checkFilter(filter, policy, 0.1, randomCloud(rng, 3000, 1.0f));
+            CHECK(VoxelGridFilterTest::generation(filter) == 2);
+        }
+    }
+}
@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "voxelGridFilter.h"
+#include "pointCloudBackprojection.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+
+constexpr std::size_t INITIAL_SLOTS = 4096;
+
+// voxel indices are packed in 21 bits each, i.e. +/- 2^20 voxels around the sensor
+constexpr double INDEX_LIMIT = 1 << 20;
+
+inline std::size_t hashKey(std::uint64_t key)
+{
+    // Fibonacci hashing, the high bits are the best mixed ones
+    return static_cast<std::size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32);
+}
+
+inline std::uint64_t packIndex(double index, int shift)
+{
+    return static_cast<std::uint64_t>(static_cast<std::int64_t>(index) + (1 << 20)) << shift;
+}
+
+} // namespace
+
+VoxelGridFilter::VoxelGridFilter(double leafSize, Policy policy) :
+        m_inverseLeaf(1.0 / leafSize),
+        m_policy(policy)
+{
+}
+
+void VoxelGridFilter::rehash(std::size_t size)
+{
+    // the slots of the older generations are free
+    m_slots.assign(size, Slot());
+    m_mask = size - 1;
+    for (std::uint32_t v = 0; v < m_voxels.size(); v++) {
+        std::size_t i = hashKey(m_voxels[v].key) & m_mask;
+        while (m_slots[i].generation == m_generation) {
+            i = (i + 1) & m_mask;
+        }
+        m_slots[i].key = m_voxels[v].key;
+        m_slots[i].generation = m_generation;
+        m_slots[i].voxel = v;
+    }
+}
+
+std::uint32_t VoxelGridFilter::findOrInsert(std::uint64_t key)
+{
+    std::size_t i = hashKey(key) & m_mask;
+    while (true) {
+        Slot& slot = m_slots[i];
+        if (slot.generation != m_generation) {
+            const auto voxel = static_cast<std::uint32_t>(m_voxels.size());
+            slot.key = key;
+            slot.generation = m_generation;
+            slot.voxel = voxel;
+            m_voxels.push_back(Voxel {key, 0, 0, 0, 0, 0, 0, 0, 0});
+            // keep the load factor below 1/2, the probe sequences stay short
+            if (2 * m_voxels.size() > m_slots.size()) {
+                rehash(2 * m_slots.size());
+            }
+            return voxel;
+        }
+        if (slot.key == key) {
+            return slot.voxel;
+        }
+        i = (i + 1) & m_mask;
+    }
+}
+
+std::size_t VoxelGridFilter::filter(const unsigned char* cloud, std::size_t count, std::vector<std::uint8_t>& out)
+{
+    m_voxels.clear();
+    if (m_slots.empty()) {
+        m_generation = 1;
+        rehash(INITIAL_SLOTS);
+    } else if (++m_generation == 0) {
+        // after a wrap around the old stamps could match again
+        m_generation = 1;
+        rehash(m_slots.size());
+    }
+
+    for (std::size_t p = 0; p < count; p++) {
+        const unsigned char* point = cloud + p * POINT_XYZRGB_STEP;
+        float xyz[3];
+        memcpy(xyz, point, sizeof(xyz));
+        const double ix = std::floor(xyz[0] * m_inverseLeaf);
+        const double iy = std::floor(xyz[1] * m_inverseLeaf);
+        const double iz = std::floor(xyz[2] * m_inverseLeaf);
+        // false for NaN too
+        if (!(std::fabs(ix) < INDEX_LIMIT && std::fabs(iy) < INDEX_LIMIT && std::fabs(iz) < INDEX_LIMIT)) {
+            continue;
+        }
+        const std::uint64_t key = packIndex(ix, 42) | packIndex(iy, 21) | packIndex(iz, 0);
+
+        Voxel& voxel = m_voxels[findOrInsert(key)];
+        const unsigned char* bgra = point + POINT_XYZRGB_RGB_OFFSET;
+        if (voxel.count == 0) {
+            memcpy(&voxel.rgb, bgra, sizeof(voxel.rgb));
+            voxel.x = xyz[0];
+            voxel.y = xyz[1];
+            voxel.z = xyz[2];
+            voxel.b = bgra[0];
+            voxel.g = bgra[1];
+            voxel.r = bgra[2];
+        } else if (m_policy == Policy::Centroid) {
+            voxel.x += xyz[0];
+            voxel.y += xyz[1];
+            voxel.z += xyz[2];
+            voxel.b += bgra[0];
+            voxel.g += bgra[1];
+            voxel.r += bgra[2];
+        }
+        voxel.count++;
+    }
+
+    out.resize(m_voxels.size() * POINT_XYZRGB_STEP);
+    unsigned char* dst = out.data();
+    for (const Voxel& voxel : m_voxels) {
+        float xyz[4] = {static_cast<float>(voxel.x), static_cast<float>(voxel.y), static_cast<float>(voxel.z), 0.0f};
+        std::uint32_t tail[4] = {voxel.rgb, 0, 0, 0};
+        if (m_policy == Policy::Centroid && voxel.count > 1) {
+            const double n = voxel.count;
+            xyz[0] = static_cast<float>(voxel.x / n);
+            xyz[1] = static_cast<float>(voxel.y / n);
+            xyz[2] = static_cast<float>(voxel.z / n);
+            const unsigned char bgra[4] = {static_cast<unsigned char>((voxel.b + voxel.count / 2) / voxel.count),
+                                           static_cast<unsigned char>((voxel.g + voxel.count / 2) / voxel.count),
+                                           static_cast<unsigned char>((voxel.r + voxel.count / 2) / voxel.count),
+                                           255};
+            memcpy(&tail[0], bgra, sizeof(bgra));
+        }
+        memcpy(dst, xyz, sizeof(xyz));
+        memcpy(dst + POINT_XYZRGB_RGB_OFFSET, tail, sizeof(tail));
+        dst += POINT_XYZRGB_STEP;
+    }
+    return m_voxels.size();
+}
@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_VOXEL_GRID_FILTER_H
+#define RGBD_ROS_VOXEL_GRID_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * Voxel grid downsampling of clouds in the POINT_XYZRGB_STEP layout (see pointCloudBackprojection.h).
+ * Each occupied voxel of a cubic grid gives one point: the centroid of its points (with their mean color),
+ * or the first point falling into it. NaN points are skipped.
+ *
+ * The voxels are looked up in an open addressing hash table; the table and the per-voxel accumulators keep
+ * their memory across calls, and the table is invalidated by bumping a generation counter instead of being
+ * cleared, so in steady state a frame costs no allocation.
+ * A filter must be used by one thread at a time.
+ */
+class VoxelGridFilter
+{
+public:
+    enum class Policy
+    {
+        Centroid,
+        First
+    };
+
+    /**
+     * @param leafSize voxel edge length, in the units of the points (i.e. metres), must be positive
+     * @param policy point published for each voxel
+     */
+    VoxelGridFilter(double leafSize, Policy policy);
+
+    /**
+     * Downsamples the `count` points of `cloud`, replacing `out` with the filtered points (same layout).
+     * Returns the number of points written, in the order their voxels were first hit.
+     */
+    std::size_t filter(const unsigned char* cloud, std::size_t count, std::vector<std::uint8_t>& out);
+
+private:
+    // the tests reach the wrap around of the generation counter through it
+    friend class VoxelGridFilterTest;
+
+    struct Slot
+    {
+        std::uint64_t key = 0;
+        std::uint32_t generation = 0;
+        std::uint32_t voxel = 0;
+    };
+
+    struct Voxel
+    {
+        std::uint64_t key;
+        double        x;
+        double        y;
+        double        z;
+        std::uint32_t b;
+        std::uint32_t g;
+        std::uint32_t r;
+        std::uint32_t count;
+        std::uint32_t rgb;
+    };
+
+    std::uint32_t findOrInsert(std::uint64_t key);
+    void          rehash(std::size_t size);
+
+    double             m_inverseLeaf;
+    Policy             m_policy;
+    std::vector<Slot>  m_slots;
+    std::size_t        m_mask = 0;
+    std::uint32_t      m_generation = 0;
+    std::vector<Voxel> m_voxels;
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_VOXEL_GRID_FILTER_H
@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "workerPool.h"
+
+#include <algorithm>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+namespace {
+// chunks handed out per participating thread, to balance rows of uneven cost
+constexpr size_t CHUNKS_PER_THREAD = 4;
+}
+
+WorkerPool::WorkerPool(size_t threads)
+{
+    m_threads.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        m_threads.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake_cv.notify_all();
+    for (auto& t : m_threads) {
+        t.join();
+    }
+}
+
+size_t WorkerPool::concurrency() const
+{
+    return m_threads.size() + 1;
+}
+
+size_t WorkerPool::defaultThreads()
+{
+    const size_t hw = std::thread::hardware_concurrency();
+    return hw > 1 ? hw - 1 : 0;
+}
+
+void WorkerPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body)
+{
+    if (begin >= end) {
+        return;
+    }
+    const size_t count = end - begin;
+    if (m_threads.empty() || count == 1) {
+        body(begin, end);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call_lock(m_call_mutex);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_body = &body;
+        m_end = end;
+        m_chunk = std::max<size_t>(1, count / (concurrency() * CHUNKS_PER_THREAD));
+        m_next.store(begin);
+        m_running = m_threads.size();
+        m_generation++;
+    }
+    m_wake_cv.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [this]() { return m_running == 0; });
+    m_body = nullptr;
+}
+
+void WorkerPool::runChunks()
+{
+    while (true) {
+        const size_t chunkBegin = m_next.fetch_add(m_chunk);
+        if (chunkBegin >= m_end) {
+            break;
+        }
+        (*m_body)(chunkBegin, std::min(chunkBegin + m_chunk, m_end));
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake_cv.wait(lock, [&]() { return m_stop || m_generation != seen; });
+            if (m_stop) {
+                return;
+            }
+            seen = m_generation;
+        }
+
+        runChunks();
+
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            last = (--m_running == 0);
+        }
+        if (last) {
+            m_done_cv.notify_one();
+        }
+    }
+}
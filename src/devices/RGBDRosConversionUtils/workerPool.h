@@ -0,0 +1,72 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef RGBD_ROS_WORKER_POOL_H
+#define RGBD_ROS_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace yarp::dev::RGBDRosConversionUtils {
+
+/**
+ * A fixed set of threads used to split per-frame work (typically image rows) into chunks.
+ * The calling thread takes part in the work, so a pool with 0 threads runs everything inline.
+ */
+class WorkerPool
+{
+public:
+    /**
+     * Creates a pool with `threads` worker threads.
+     */
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /**
+     * Calls `body(chunkBegin, chunkEnd)` on disjoint chunks covering [begin, end), concurrently on the
+     * worker threads and on the calling one, and returns when all of them are done.
+     * Concurrent calls from different threads are serialized.
+     */
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t, size_t)>& body);
+
+    /**
+     * Number of threads taking part in a parallelFor() (worker threads plus the calling one).
+     */
+    size_t concurrency() const;
+
+    /**
+     * Number of worker threads to use by default: one less than the hardware threads.
+     */
+    static size_t defaultThreads();
+
+private:
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread>                  m_threads;
+    std::mutex                                m_call_mutex;
+    std::mutex                                m_mutex;
+    std::condition_variable                   m_wake_cv;
+    std::condition_variable                   m_done_cv;
+    const std::function<void(size_t, size_t)>* m_body = nullptr;
+    size_t                                    m_end = 0;
+    size_t                                    m_chunk = 1;
+    std::atomic<size_t>                       m_next {0};
+    size_t                                    m_running = 0;
+    size_t                                    m_generation = 0;
+    bool                                      m_stop = false;
+};
+
+} // namespace yarp::dev::RGBDRosConversionUtils
+
+#endif // RGBD_ROS_WORKER_POOL_H
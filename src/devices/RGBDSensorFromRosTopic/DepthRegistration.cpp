@@ -0,0 +1,175 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "DepthRegistration.h"
+
+#include <cmath>
+#include <cstring>
+
+using namespace yarp::sig;
+using yarp::dev::RGBDRosConversionUtils::CameraIntrinsics;
+
+namespace {
+
+// bit pattern of +inf: larger than the one of any finite positive float
+constexpr uint32_t EMPTY_DEPTH = 0x7F800000u;
+
+// number of fixed point iterations used to invert the plumb_bob distortion
+constexpr int UNDISTORT_ITERATIONS = 5;
+
+inline uint32_t floatBits(float f)
+{
+    uint32_t b;
+    memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+inline float bitsFloat(uint32_t b)
+{
+    float f;
+    memcpy(&f, &b, sizeof(f));
+    return f;
+}
+
+// For positive floats the bit patterns are ordered as the values
+inline void atomicMin(std::atomic<uint32_t>& target, uint32_t value)
+{
+    uint32_t current = target.load(std::memory_order_relaxed);
+    while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+} // namespace
+
+DepthRegistration::DepthRegistration(size_t threads) :
+        m_pool(threads)
+{
+}
+
+void DepthRegistration::setExtrinsics(const Matrix& depthToColor)
+{
+    for (size_t r = 0; r < 3; r++) {
+        for (size_t c = 0; c < 3; c++) {
+            m_R[r * 3 + c] = static_cast<float>(depthToColor(r, c));
+        }
+        m_t[r] = static_cast<float>(depthToColor(r, 3));
+    }
+}
+
+void DepthRegistration::updateRays(const CameraIntrinsics& depthIntrinsics, size_t width, size_t height)
+{
+    if (m_rays_version == depthIntrinsics.version && m_rays_width == width && m_rays_height == height) {
+        return;
+    }
+
+    const IntrinsicParams& p = depthIntrinsics.params;
+    const YarpDistortionParams& d = p.distortionModel;
+    const bool undistort = d.type == YarpDistortion::YARP_PLUMB_BOB &&
+                           (d.k1 != 0 || d.k2 != 0 || d.k3 != 0 || d.t1 != 0 || d.t2 != 0);
+
+    m_rays.resize(2 * width * height);
+    m_pool.parallelFor(0, height, [&](size_t r0, size_t r1) {
+        for (size_t r = r0; r < r1; r++) {
+            float* ray = m_rays.data() + 2 * r * width;
+            const double yd = (static_cast<double>(r) - p.principalPointY) / p.focalLengthY;
+            for (size_t c = 0; c < width; c++) {
+                const double xd = (static_cast<double>(c) - p.principalPointX) / p.focalLengthX;
+                double x = xd;
+                double y = yd;
+                if (undistort) {
+                    for (int i = 0; i < UNDISTORT_ITERATIONS; i++) {
+                        const double r2 = x * x + y * y;
+                        const double radial = 1 + r2 * (d.k1 + r2 * (d.k2 + r2 * d.k3));
+                        const double dx = 2 * d.t1 * x * y + d.t2 * (r2 + 2 * x * x);
+                        const double dy = d.t1 * (r2 + 2 * y * y) + 2 * d.t2 * x * y;
+                        x = (xd - dx) / radial;
+                        y = (yd - dy) / radial;
+                    }
+                }
+                ray[2 * c] = static_cast<float>(x);
+                ray[2 * c + 1] = static_cast<float>(y);
+            }
+        }
+    });
+
+    m_rays_version = depthIntrinsics.version;
+    m_rays_width = width;
+    m_rays_height = height;
+}
+
+bool DepthRegistration::process(const DepthImage& depth,
+                                const CameraIntrinsics& depthIntrinsics,
+                                const CameraIntrinsics& colorIntrinsics,
+                                DepthImage& registered)
+{
+    const size_t colorWidth = colorIntrinsics.width;
+    const size_t colorHeight = colorIntrinsics.height;
+    if (colorWidth == 0 || colorHeight == 0 ||
+        depthIntrinsics.params.focalLengthX <= 0 || depthIntrinsics.params.focalLengthY <= 0 ||
+        colorIntrinsics.params.focalLengthX <= 0 || colorIntrinsics.params.focalLengthY <= 0) {
+        return false;
+    }
+
+    const size_t width = depth.width();
+    const size_t height = depth.height();
+    updateRays(depthIntrinsics, width, height);
+
+    if (m_zbuffer_size != colorWidth * colorHeight) {
+        m_zbuffer_size = colorWidth * colorHeight;
+        m_zbuffer.reset(new std::atomic<uint32_t>[m_zbuffer_size]);
+        for (size_t i = 0; i < m_zbuffer_size; i++) {
+            m_zbuffer[i].store(EMPTY_DEPTH, std::memory_order_relaxed);
+        }
+    }
+    registered.resize(colorWidth, colorHeight);
+
+    const float fx = static_cast<float>(colorIntrinsics.params.focalLengthX);
+    const float fy = static_cast<float>(colorIntrinsics.params.focalLengthY);
+    const float cx = static_cast<float>(colorIntrinsics.params.principalPointX);
+    const float cy = static_cast<float>(colorIntrinsics.params.principalPointY);
+    const float* R = m_R;
+    const float* t = m_t;
+
+    // forward projection of the depth samples, keeping the closest one per color pixel
+    m_pool.parallelFor(0, height, [&](size_t r0, size_t r1) {
+        for (size_t r = r0; r < r1; r++) {
+            const float* row = reinterpret_cast<const float*>(depth.getRow(r));
+            const float* ray = m_rays.data() + 2 * r * width;
+            for (size_t c = 0; c < width; c++) {
+                const float z = row[c];
+                if (!(z > 0) || !std::isfinite(z)) {
+                    continue;
+                }
+                const float X = ray[2 * c] * z;
+                const float Y = ray[2 * c + 1] * z;
+                const float pz = R[6] * X + R[7] * Y + R[8] * z + t[2];
+                if (!(pz > 0)) {
+                    continue;
+                }
+                const float px = R[0] * X + R[1] * Y + R[2] * z + t[0];
+                const float py = R[3] * X + R[4] * Y + R[5] * z + t[1];
+                const float u = std::floor(fx * px / pz + cx + 0.5f);
+                const float v = std::floor(fy * py / pz + cy + 0.5f);
+                if (u < 0 || v < 0 || u >= static_cast<float>(colorWidth) || v >= static_cast<float>(colorHeight)) {
+                    continue;
+                }
+                atomicMin(m_zbuffer[static_cast<size_t>(v) * colorWidth + static_cast<size_t>(u)], floatBits(pz));
+            }
+        }
+    });
+
+    // z-buffer to image, leaving the z-buffer empty for the next frame
+    m_pool.parallelFor(0, colorHeight, [&](size_t r0, size_t r1) {
+        for (size_t r = r0; r < r1; r++) {
+            float* out = reinterpret_cast<float*>(registered.getRow(r));
+            std::atomic<uint32_t>* z = m_zbuffer.get() + r * colorWidth;
+            for (size_t c = 0; c < colorWidth; c++) {
+                const uint32_t bits = z[c].exchange(EMPTY_DEPTH, std::memory_order_relaxed);
+                out[c] = (bits == EMPTY_DEPTH) ? 0.0f : bitsFloat(bits);
+            }
+        }
+    });
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef YARP_DEV_RGBDSENSORFROMROSTOPIC_DEPTHREGISTRATION_H
+#define YARP_DEV_RGBDSENSORFROMROSTOPIC_DEPTHREGISTRATION_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <yarp/sig/Matrix.h>
+
+#include <RGBDRosConversionUtils.h>
+#include <workerPool.h>
+
+/**
+ * Reprojects depth images into the color camera, producing depth images with the color resolution
+ * whose pixels are aligned with the color ones (0 where no depth sample lands).
+ *
+ * The viewing ray of every depth pixel (undistorted, if the depth camera_info has a plumb_bob model)
+ * is computed once and cached until the depth intrinsics change, so each frame only costs a rigid
+ * transform and a projection per pixel. Rows are processed in parallel; when several depth samples
+ * land on the same color pixel the closest one wins.
+ * The color distortion is not modelled.
+ */
+class DepthRegistration
+{
+public:
+    explicit DepthRegistration(size_t threads);
+
+    /**
+     * Sets the 4x4 rigid transform from the depth camera frame to the color camera frame (metres).
+     */
+    void setExtrinsics(const yarp::sig::Matrix& depthToColor);
+
+    /**
+     * Registers `depth` into `registered`. Returns false if the intrinsics are not usable.
+     */
+    bool process(const DepthImage& depth,
+                 const yarp::dev::RGBDRosConversionUtils::CameraIntrinsics& depthIntrinsics,
+                 const yarp::dev::RGBDRosConversionUtils::CameraIntrinsics& colorIntrinsics,
+                 DepthImage& registered);
+
+private:
+    void updateRays(const yarp::dev::RGBDRosConversionUtils::CameraIntrinsics& depthIntrinsics, size_t width, size_t height);
+
+    yarp::dev::RGBDRosConversionUtils::WorkerPool m_pool;
+
+    // depth to color transform
+    float m_R[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    float m_t[3] = { 0, 0, 0 };
+
+    // (x/z, y/z) of the ray of every depth pixel
+    std::vector<float> m_rays;
+    size_t             m_rays_version = 0;
+    size_t             m_rays_width = 0;
+    size_t             m_rays_height = 0;
+
+    // closest depth landed on each color pixel, as the bit pattern of a positive float
+    std::unique_ptr<std::atomic<uint32_t>[]> m_zbuffer;
+    size_t                                   m_zbuffer_size = 0;
+};
+
+#endif // YARP_DEV_RGBDSENSORFROMROSTOPIC_DEPTHREGISTRATION_H
@@ -4,20 +4,59 @@
  */
 
 #include <algorithm>
+#include <cmath>
 
 #include <yarp/os/LogComponent.h>
 #include <yarp/os/Value.h>
+#include <yarp/dev/GenericVocabs.h>
 #include <yarp/sig/ImageUtils.h>
 
 #include "RGBDSensorFromRosTopic.h"
+#include <depthConversion.h>
+#include <workerPool.h>
 
 using namespace yarp::dev;
 using namespace yarp::sig;
 using namespace yarp::os;
+using yarp::dev::RGBDRosConversionUtils::StampedImage;
 
 
 namespace {
 YARP_LOG_COMPONENT(RGBD_ROS_TOPIC, "yarp.device.RGBDSensorFromRosTopic")
+
+// Reads the `<prefix>_roi` and `<prefix>_decimation` options
+bool parseIngestWindow(Searchable& config, const std::string& prefix, yarp::dev::RGBDRosConversionUtils::IngestWindow& window)
+{
+    const std::string roi_key = prefix + "_roi";
+    if (config.check(roi_key)) {
+        Bottle* roi = config.find(roi_key).asList();
+        if (roi == nullptr || roi->size() != 4) {
+            yCError(RGBD_ROS_TOPIC) << roi_key << "must be a list of four values (x y width height)";
+            return false;
+        }
+        for (size_t i = 0; i < 4; i++) {
+            if (roi->get(i).asInt32() < 0) {
+                yCError(RGBD_ROS_TOPIC) << roi_key << "values cannot be negative";
+                return false;
+            }
+        }
+        window.x = static_cast<size_t>(roi->get(0).asInt32());
+        window.y = static_cast<size_t>(roi->get(1).asInt32());
+        window.width = static_cast<size_t>(roi->get(2).asInt32());
+        window.height = static_cast<size_t>(roi->get(3).asInt32());
+    }
+
+    const std::string decimation_key = prefix + "_decimation";
+    if (config.check(decimation_key)) {
+        int decimation = config.find(decimation_key).asInt32();
+        if (decimation < 1) {
+            yCError(RGBD_ROS_TOPIC) << decimation_key << "must be at least 1";
+            return false;
+        }
+        window.decimation = static_cast<size_t>(decimation);
+    }
+    return true;
+}
 }
 
 
@@ -54,30 +93,174 @@ bool RGBDSensorFromRosTopic::open(Searchable& config)
         yCError(RGBD_ROS_TOPIC) << "node_name must begin with an initial /";
         return false;
     }
+
+    double depth_scale = yarp::dev::RGBDRosConversionUtils::DEFAULT_DEPTH_SCALE;
+    if (config.check("depth_scale")) {
+        depth_scale = config.find("depth_scale").asFloat64();
+        if (depth_scale <= 0) {
+            yCError(RGBD_ROS_TOPIC) << "depth_scale must be a positive number";
+            return false;
+        }
+    }
+
+    if (config.check("sync_slop")) {
+        m_sync_slop = config.find("sync_slop").asFloat64();
+    }
+    size_t sync_queue_size = 1;
+    if (m_sync_slop > 0) {
+        sync_queue_size = DEFAULT_SYNC_QUEUE_SIZE;
+        if (config.check("sync_queue_size")) {
+            int queue_size = config.find("sync_queue_size").asInt32();
+            if (queue_size < 1) {
+                yCError(RGBD_ROS_TOPIC) << "sync_queue_size must be at least 1";
+                return false;
+            }
+            sync_queue_size = static_cast<size_t>(queue_size);
+        }
+    }
+
+    int rgb_format = 0;
+    if (config.check("rgb_format")) {
+        std::string format = config.find("rgb_format").asString();
+        if (format == "rgb") {
+            rgb_format = VOCAB_PIXEL_RGB;
+        } else if (format == "bgr") {
+            rgb_format = VOCAB_PIXEL_BGR;
+        } else if (format != "native") {
+            yCError(RGBD_ROS_TOPIC) << "rgb_format must be one of native, rgb, bgr";
+            return false;
+        }
+    }
+
+    yarp::dev::RGBDRosConversionUtils::IngestWindow rgb_window;
+    yarp::dev::RGBDRosConversionUtils::IngestWindow depth_window;
+    if (!parseIngestWindow(config, "rgb", rgb_window) ||
+        !parseIngestWindow(config, "depth", depth_window)) {
+        return false;
+    }
+    if (config.check("depth_pooling")) {
+        std::string pooling = config.find("depth_pooling").asString();
+        if (pooling == "min") {
+            depth_window.minDepthPooling = true;
+        } else if (pooling != "nearest") {
+            yCError(RGBD_ROS_TOPIC) << "depth_pooling must be one of nearest, min";
+            return false;
+        }
+    }
+
+    if (config.check("frame_wait_timeout")) {
+        m_frame_wait_timeout = config.find("frame_wait_timeout").asFloat64();
+    }
+
+    if (config.check("extrinsic")) {
+        Bottle* extrinsic = config.find("extrinsic").asList();
+        if (extrinsic == nullptr || extrinsic->size() != 16) {
+            yCError(RGBD_ROS_TOPIC) << "extrinsic must be a list of 16 values (row-major 4x4 depth to color transform)";
+            return false;
+        }
+        m_extrinsic.resize(4, 4);
+        for (size_t r = 0; r < 4; r++) {
+            for (size_t c = 0; c < 4; c++) {
+                m_extrinsic(r, c) = extrinsic->get(r * 4 + c).asFloat64();
+            }
+        }
+        m_has_extrinsic = true;
+    }
+
+    m_register_depth = config.check("register_depth") && config.find("register_depth").asBool();
+    if (m_register_depth) {
+        if (!m_has_extrinsic) {
+            yCWarning(RGBD_ROS_TOPIC) << "register_depth without extrinsic: assuming coincident depth and color cameras";
+            m_extrinsic.resize(4, 4);
+            m_extrinsic.eye();
+        }
+        size_t threads = yarp::dev::RGBDRosConversionUtils::WorkerPool::defaultThreads();
+        if (config.check("registration_threads")) {
+            int n = config.find("registration_threads").asInt32();
+            if (n < 0) {
+                yCError(RGBD_ROS_TOPIC) << "registration_threads cannot be negative";
+                return false;
+            }
+            threads = static_cast<size_t>(n);
+        }
+        m_registration = std::make_unique<DepthRegistration>(threads);
+        m_registration->setExtrinsics(m_extrinsic);
+    }
+
     m_ros_node = new yarp::os::Node(node_name);
 
     //m_rgb_input_processor.useCallback();    ///@@@<-SEGFAULT
     //m_depth_input_processor.useCallback();    ///@@@<-SEGFAULT
     m_rgb_input_processor = new yarp::dev::RGBDRosConversionUtils::commonImageProcessor(color_topic_name, rgb_info_topic_name);
     m_depth_input_processor = new yarp::dev::RGBDRosConversionUtils::commonImageProcessor(depth_topic_name, depth_info_topic_name);
+    m_depth_input_processor->setDepthScale(depth_scale);
+    m_rgb_input_processor->setColorFormat(rgb_format);
+    m_rgb_input_processor->setIngestWindow(rgb_window);
+    m_depth_input_processor->setIngestWindow(depth_window);
+    m_rgb_input_processor->setHistoryDepth(sync_queue_size);
+    m_depth_input_processor->setHistoryDepth(sync_queue_size);
+    if (m_registration) {
+        // depth frames are registered once, on arrival, for all the clients
+        m_depth_input_processor->setDepthPostProcess([this](const DepthImage& depth, DepthImage& registered) {
+            auto depth_intrinsics = m_depth_input_processor->getIntrinsics();
+            auto color_intrinsics = m_rgb_input_processor->getIntrinsics();
+            if (!depth_intrinsics || !color_intrinsics) {
+                yCWarningThrottle(RGBD_ROS_TOPIC, 5) << "Depth frame dropped: no"
+                                                     << (!depth_intrinsics ? (!color_intrinsics ? "depth and color" : "depth") : "color")
+                                                     << "camera_info received yet";
+                return false;
+            }
+            if (!m_registration->process(depth, *depth_intrinsics, *color_intrinsics, registered)) {
+                yCWarningThrottle(RGBD_ROS_TOPIC, 5) << "Depth frame dropped: registration failed, the depth or color camera_info has a zero image size or focal length";
+                return false;
+            }
+            return true;
+        });
+    }
     m_rgb_input_processor->useCallback();    ///@@@<-OK
     m_depth_input_processor->useCallback();    ///@@@<-OK
 
+    if (config.check("stats_port_name")) {
+        std::string stats_port_name = config.find("stats_port_name").asString();
+        if (!m_stats_port.open(stats_port_name)) {
+            yCError(RGBD_ROS_TOPIC) << "Failed to open port" << stats_port_name;
+            // stops the subscribers and releases the processors and the node created above
+            close();
+            return false;
+        }
+        m_stats_port.setReader(*this);
+    }
+
     return true;
 }
 
 bool RGBDSensorFromRosTopic::close()
 {
+    // the statistics port reads the processors: close it before deleting them
+    m_stats_port.close();
+    // release the getters waiting for frames, then wait for them to leave before deleting the processors
+    if (m_depth_input_processor)
+    {
+        m_depth_input_processor->interruptWaits();
+    }
     if (m_rgb_input_processor)
     {
-       delete m_rgb_input_processor;
-       m_rgb_input_processor =nullptr;
+        m_rgb_input_processor->interruptWaits();
     }
+    std::unique_lock<std::shared_mutex> processors(m_processors_mutex);
+    std::lock_guard<std::mutex> guard(m_mutex);
+    // the depth callback may use the color processor (depth registration): stop it first
     if (m_depth_input_processor)
     {
        delete m_depth_input_processor;
        m_depth_input_processor = nullptr;
     }
+    if (m_rgb_input_processor)
+    {
+       delete m_rgb_input_processor;
+       m_rgb_input_processor =nullptr;
+    }
+    m_registration.reset();
     if (m_ros_node)
     {
        delete m_ros_node;
@@ -225,6 +408,11 @@ bool RGBDSensorFromRosTopic::getDepthFOV(double& horizontalFov, double& vertical
         verticalFov = 0;
         return true;
     }
+    // registered depth images share the color camera model
+    if (m_register_depth && m_rgb_input_processor != nullptr)
+    {
+        return m_rgb_input_processor->getFOV(horizontalFov, verticalFov);
+    }
     return m_depth_input_processor->getFOV(horizontalFov, verticalFov);
 }
 
@@ -235,6 +423,10 @@ bool RGBDSensorFromRosTopic::getDepthIntrinsicParam(Property& intrinsic)
         intrinsic.clear();
         return true;
     }
+    if (m_register_depth && m_rgb_input_processor != nullptr)
+    {
+        return m_rgb_input_processor->getIntrinsicParam(intrinsic);
+    }
     return m_depth_input_processor->getIntrinsicParam(intrinsic);
 }
 
@@ -276,39 +468,191 @@ bool RGBDSensorFromRosTopic::setDepthMirroring(bool mirror)
 
 bool RGBDSensorFromRosTopic::getExtrinsicParam(Matrix& extrinsic)
 {
-    YARP_UNUSED(extrinsic);
-    yCWarning(RGBD_ROS_TOPIC) << "getExtrinsicParam not supported";
+    if (m_register_depth)
+    {
+        // registered depth images are already expressed in the color camera frame
+        extrinsic.resize(4, 4);
+        extrinsic.eye();
+        return true;
+    }
+    if (m_has_extrinsic)
+    {
+        extrinsic = m_extrinsic;
+        return true;
+    }
+    yCWarning(RGBD_ROS_TOPIC) << "getExtrinsicParam not supported: no extrinsic configured";
     return  false;
 }
 
 bool RGBDSensorFromRosTopic::getRgbImage(FlexImage& rgbImage, Stamp* timeStamp)
 {
+    std::shared_lock<std::shared_mutex> processors(m_processors_mutex);
+    if (m_rgb_input_processor == nullptr)
+    {
+        return false;
+    }
+
+    // wait without m_mutex, the other getters must not be blocked meanwhile
+    int lastCount = -1;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        lastCount = m_lastColorCount;
+    }
+    if (!waitForNewFrame(m_rgb_input_processor, lastCount))
+    {
+        return false;
+    }
+
     std::lock_guard<std::mutex> guard(m_mutex);
-    bool rgb_ok = false;
-    if (m_rgb_input_processor!=nullptr)
-        { rgb_ok = m_rgb_input_processor->getLastRGBData(rgbImage, *timeStamp); }
-    return rgb_ok;
+    Stamp stamp;
+    if (!m_rgb_input_processor->getLastRGBData(rgbImage, stamp))
+    {
+        return false;
+    }
+    m_lastColorCount = stamp.getCount();
+    if (timeStamp != nullptr)
+        { *timeStamp = stamp; }
+    return true;
 }
 
 bool RGBDSensorFromRosTopic::getDepthImage(ImageOf<PixelFloat>& depthImage, Stamp* timeStamp)
 {
+    std::shared_lock<std::shared_mutex> processors(m_processors_mutex);
+    if (m_depth_input_processor == nullptr)
+    {
+        return false;
+    }
+
+    int lastCount = -1;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        lastCount = m_lastDepthCount;
+    }
+    if (!waitForNewFrame(m_depth_input_processor, lastCount))
+    {
+        return false;
+    }
+
     std::lock_guard<std::mutex> guard(m_mutex);
-    bool depth_ok =false;
-    if (m_depth_input_processor != nullptr)
-       { depth_ok = m_depth_input_processor->getLastDepthData(depthImage, *timeStamp); }
-    return depth_ok;
+    Stamp stamp;
+    if (!m_depth_input_processor->getLastDepthData(depthImage, stamp))
+    {
+        return false;
+    }
+    m_lastDepthCount = stamp.getCount();
+    if (timeStamp != nullptr)
+       { *timeStamp = stamp; }
+    return true;
 }
 
 bool RGBDSensorFromRosTopic::getImages(FlexImage& colorFrame, ImageOf<PixelFloat>& depthFrame, Stamp* colorStamp, Stamp* depthStamp)
 {
-    bool rgb_ok = false;
-    bool depth_ok = false;
+    std::shared_lock<std::shared_mutex> processors(m_processors_mutex);
+    if (m_rgb_input_processor == nullptr || m_depth_input_processor == nullptr)
+    {
+        return false;
+    }
+
+    int lastColorCount = -1;
+    int lastDepthCount = -1;
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        lastColorCount = m_lastColorCount;
+        lastDepthCount = m_lastDepthCount;
+    }
+    if (!waitForNewFrame(m_rgb_input_processor, lastColorCount) ||
+        !waitForNewFrame(m_depth_input_processor, lastDepthCount))
+    {
+        return false;
+    }
+
     std::lock_guard<std::mutex> guard(m_mutex);
-    if (m_rgb_input_processor != nullptr)
-       { rgb_ok = m_rgb_input_processor->getLastRGBData(colorFrame, *colorStamp); }
-    if (m_depth_input_processor != nullptr)
-       { depth_ok = m_depth_input_processor->getLastDepthData(depthFrame, *depthStamp); }
-    return (rgb_ok && depth_ok);
+    Stamp rgb_stamp;
+    Stamp depth_stamp;
+    if (m_sync_slop > 0)
+    {
+        // The matched pair can be older than the newest frames: the next wait must be for frames newer
+        // than the newest ones considered here, or the same pair would be returned again.
+        // The counts are read before the histories, which contain at least those frames.
+        const int newestColorCount = m_rgb_input_processor->getPublishedCount();
+        const int newestDepthCount = m_depth_input_processor->getPublishedCount();
+        if (!getSynchronizedImages(colorFrame, depthFrame, &rgb_stamp, &depth_stamp))
+        {
+            return false;
+        }
+        m_lastColorCount = newestColorCount;
+        m_lastDepthCount = newestDepthCount;
+    }
+    else
+    {
+        bool rgb_ok = m_rgb_input_processor->getLastRGBData(colorFrame, rgb_stamp);
+        bool depth_ok = m_depth_input_processor->getLastDepthData(depthFrame, depth_stamp);
+        if (!rgb_ok || !depth_ok)
+        {
+            return false;
+        }
+        m_lastColorCount = rgb_stamp.getCount();
+        m_lastDepthCount = depth_stamp.getCount();
+    }
+
+    if (colorStamp != nullptr) { *colorStamp = rgb_stamp; }
+    if (depthStamp != nullptr) { *depthStamp = depth_stamp; }
+    return true;
+}
+
+bool RGBDSensorFromRosTopic::waitForNewFrame(RGBDRosConversionUtils::commonImageProcessor* processor, int lastCount)
+{
+    if (m_frame_wait_timeout <= 0)
+    {
+        return true;
+    }
+    if (!processor->waitForFrame(lastCount, m_frame_wait_timeout))
+    {
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_lastError = "timeout waiting for a new frame";
+        }
+        yCWarningThrottle(RGBD_ROS_TOPIC, 5.0) << "No new frame received within" << m_frame_wait_timeout << "s";
+        return false;
+    }
+    return true;
+}
+
+bool RGBDSensorFromRosTopic::getSynchronizedImages(FlexImage& colorFrame, ImageOf<PixelFloat>& depthFrame, Stamp* colorStamp, Stamp* depthStamp)
+{
+    auto colorHistory = m_rgb_input_processor->getRGBHistory();
+    auto depthHistory = m_depth_input_processor->getDepthHistory();
+
+    // Look for the most recent color frame having a depth frame within the allowed slop,
+    // pairing it with the closest depth frame in time.
+    std::sort(colorHistory.begin(), colorHistory.end(),
+              [](const auto& a, const auto& b) { return a->stamp.getTime() > b->stamp.getTime(); });
+    for (const auto& color : colorHistory)
+    {
+        std::shared_ptr<const StampedImage<ImageOf<PixelFloat>>> best;
+        double best_delta = m_sync_slop;
+        for (const auto& depth : depthHistory)
+        {
+            double delta = std::fabs(color->stamp.getTime() - depth->stamp.getTime());
+            if (delta <= best_delta)
+            {
+                best_delta = delta;
+                best = depth;
+            }
+        }
+        if (best)
+        {
+            colorFrame = color->image;
+            depthFrame = best->image;
+            if (colorStamp != nullptr) { *colorStamp = color->stamp; }
+            if (depthStamp != nullptr) { *depthStamp = best->stamp; }
+            return true;
+        }
+    }
+
+    m_lastError = "no color/depth pair within the configured sync_slop";
+    yCWarningThrottle(RGBD_ROS_TOPIC, 5.0) << "No color/depth pair within" << m_sync_slop << "s";
+    return false;
 }
 
 RGBDSensorFromRosTopic::RGBDSensor_status RGBDSensorFromRosTopic::getSensorStatus()
@@ -319,6 +663,7 @@ RGBDSensorFromRosTopic::RGBDSensor_status RGBDSensorFromRosTopic::getSensorStatu
 std::string RGBDSensorFromRosTopic::getLastErrorMsg(Stamp* timeStamp)
 {
     YARP_UNUSED(timeStamp);
+    std::lock_guard<std::mutex> guard(m_mutex);
     return m_lastError;
 }
 
@@ -416,3 +761,65 @@ bool RGBDSensorFromRosTopic::setOnePush(int feature)
     return false;
 }
 */
+
+bool RGBDSensorFromRosTopic::read(yarp::os::ConnectionReader& connection)
+{
+    yarp::os::Bottle command;
+    yarp::os::Bottle reply;
+    bool ok = command.read(connection);
+    if (!ok) {
+        return false;
+    }
+
+    reply.clear();
+
+    const std::string cmd = command.get(0).asString();
+    if (cmd == "help")
+    {
+        reply.addVocab32("many");
+        reply.addString("stats: returns the ingest statistics of the color and depth streams");
+        reply.addString("reset: clears the ingest statistics");
+    }
+    else if (cmd == "stats")
+    {
+        if (m_rgb_input_processor != nullptr && m_depth_input_processor != nullptr)
+        {
+            yarp::os::Bottle& color = reply.addList();
+            color.addString("color");
+            m_rgb_input_processor->getStatistics().toBottle(color);
+            yarp::os::Bottle& depth = reply.addList();
+            depth.addString("depth");
+            m_depth_input_processor->getStatistics().toBottle(depth);
+        }
+        else
+        {
+            reply.addVocab32(VOCAB_ERR);
+        }
+    }
+    else if (cmd == "reset")
+    {
+        if (m_rgb_input_processor != nullptr && m_depth_input_processor != nullptr)
+        {
+            m_rgb_input_processor->resetStatistics();
+            m_depth_input_processor->resetStatistics();
+            reply.addVocab32(VOCAB_OK);
+        }
+        else
+        {
+            reply.addVocab32(VOCAB_ERR);
+        }
+    }
+    else
+    {
+        yCError(RGBD_ROS_TOPIC) << "Invalid command. Try `help`";
+        reply.addVocab32(VOCAB_ERR);
+    }
+
+    yarp::os::ConnectionWriter* returnToSender = connection.getWriter();
+    if (returnToSender != nullptr)
+    {
+        reply.write(*returnToSender);
+    }
+
+    return true;
+}
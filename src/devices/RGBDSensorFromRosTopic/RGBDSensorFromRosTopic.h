@@ -9,7 +9,9 @@
 #include <iostream>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
 
 #include <yarp/dev/DeviceDriver.h>
 #include <yarp/os/PeriodicThread.h>
@@ -17,9 +19,12 @@
 #include <yarp/sig/Matrix.h>
 #include <yarp/os/Stamp.h>
 #include <yarp/os/Property.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/RpcServer.h>
 #include <yarp/dev/IRGBDSensor.h>
 #include <yarp/dev/RGBDSensorParamParser.h>
 #include <RGBDRosConversionUtils.h>
+#include "DepthRegistration.h"
 
 #include <yarp/os/Node.h>
 #include <yarp/os/Subscriber.h>
@@ -172,6 +177,20 @@ typedef yarp::sig::ImageOf<yarp::sig::PixelFloat> depthImage;
  * |  color_topic_name       |      -              | string              | -              | -             |  Yes       | The device connects to this ROS topic to get RGB data (there must be also camera_info with the last subtopic)|         |
  * |  depth_topic_name       |      -              | string              | -              | -             |  Yes       | The device connects to this ROS topic to get Depth data (there must be also camera_info with the last subtopic)    |         | * |  node_name                   |      -              | string              | -              | -             |  Yes       | the name of the ros node                                                                             |         |
  * |  node_name              |      -              | string              | -              | -             |  Yes       | the name of the ros node    |         | * |  node_name                   |      -              | string              | -              | -             |  Yes       | the name of the ros node                                                                             |         |
+ * |  sync_slop              |      -              | double              | s              | 0             |  No        | if greater than 0, getImages() returns the most recent color/depth pair whose header stamps differ less than this value; 0 returns the latest frames of each stream |         |
+ * |  sync_queue_size        |      -              | int                 | -              | 5             |  No        | number of frames per stream kept to look for a synchronized pair (used only if sync_slop > 0)       |         |
+ * |  frame_wait_timeout     |      -              | double              | s              | 0             |  No        | if greater than 0, getImages()/getRgbImage()/getDepthImage() block until a frame newer than the last returned one arrives (failing after this timeout) instead of returning the last frame again |         |
+ * |  depth_scale            |      -              | double              | m              | 0.001         |  No        | scale factor applied to 16 bit (`16UC1`) depth samples to convert them to metres                     |         |
+ * |  rgb_format             |      -              | string              | -              | native        |  No        | pixel format of the color images: `rgb` or `bgr` convert every supported encoding (rgb8, bgr8, rgba8, bgra8, bayer_*8) to it, `native` keeps the received one (bayer images are demosaiced to rgb) |         |
+ * |  rgb_roi                |      -              | list of int         | pixel          | -             |  No        | region (x y width height) of the received color images that is converted, a 0 width/height extends it to the image border |         |
+ * |  rgb_decimation         |      -              | int                 | -              | 1             |  No        | integer decimation applied to the color images (after rgb_roi); bayer images are binned 2x2 | with bayer binning the intrinsics refer each pixel to the centre of its 2x2 cell |
+ * |  depth_roi              |      -              | list of int         | pixel          | -             |  No        | region (x y width height) of the received depth images that is converted, a 0 width/height extends it to the image border |         |
+ * |  depth_decimation       |      -              | int                 | -              | 1             |  No        | integer decimation applied to the depth images (after depth_roi)                                   |         |
+ * |  depth_pooling          |      -              | string              | -              | nearest       |  No        | depth decimation policy: `nearest` keeps the top-left sample of each block, `min` the closest valid one | intrinsics are adapted to roi and decimation, referring each pixel to the top-left sample of its block (`nearest`) or to the block centre (`min`) |
+ * |  extrinsic              |      -              | list of double      | m              | -             |  No        | row-major 4x4 rigid transform from the depth camera frame to the color camera frame, returned by getExtrinsicParam() |         |
+ * |  register_depth         |      -              | bool                | -              | false         |  No        | if true depth images are reprojected into the color camera (color resolution, aligned to the color pixels, 0 where no sample lands) | depth intrinsics become the color ones, extrinsic the identity |
+ * |  registration_threads   |      -              | int                 | -              | cores - 1     |  No        | worker threads used by the depth registration, besides the receiving one                            |         |
+ * |  stats_port_name        |      -              | string              | -              | -             |  No        | if set, an rpc port with this name answers `stats` (per-stream ingest statistics), `reset` and `help` |         |
  *
  * Example of configuration file (using .ini format) when the device is wrapped by RGBDSensorWrapper.
  *
@@ -186,7 +205,8 @@ typedef yarp::sig::ImageOf<yarp::sig::PixelFloat> depthImage;
 
 class RGBDSensorFromRosTopic :
         public yarp::dev::DeviceDriver,
-        public yarp::dev::IRGBDSensor
+        public yarp::dev::IRGBDSensor,
+        public yarp::os::PortReader
 {
 private:
     typedef yarp::os::Stamp                           Stamp;
@@ -233,6 +253,9 @@ public:
     RGBDSensor_status     getSensorStatus() override;
     std::string getLastErrorMsg(Stamp* timeStamp = nullptr) override;
 
+    // PortReader (statistics rpc port)
+    bool read(yarp::os::ConnectionReader& connection) override;
+
     /*
     //IFrameGrabberControls
     bool   getCameraDescription(CameraDescriptor *camera) override;
@@ -254,10 +277,35 @@ public:
 
     // ros-topic related
     mutable std::mutex m_mutex;
+    // held (shared) by the getters while they wait for frames without m_mutex, and exclusively by close()
+    // before deleting the processors
+    std::shared_mutex m_processors_mutex;
     yarp::os::Node* m_ros_node = nullptr;
     yarp::dev::RGBDRosConversionUtils::commonImageProcessor*   m_rgb_input_processor = nullptr;
     yarp::dev::RGBDRosConversionUtils::commonImageProcessor*   m_depth_input_processor = nullptr;
 
     std::string m_lastError;
+
+    // approximate time synchronization of color and depth frames
+    static constexpr size_t DEFAULT_SYNC_QUEUE_SIZE = 5;
+    double m_sync_slop = 0;
+
+    bool getSynchronizedImages(FlexImage& colorFrame, depthImage& depthFrame, Stamp* colorStamp, Stamp* depthStamp);
+
+    // frame arrival driven mode
+    double m_frame_wait_timeout = 0;
+    int    m_lastColorCount = -1;
+    int    m_lastDepthCount = -1;
+
+    bool waitForNewFrame(yarp::dev::RGBDRosConversionUtils::commonImageProcessor* processor, int lastCount);
+
+    // depth to color extrinsics and registration
+    yarp::sig::Matrix                  m_extrinsic;
+    bool                               m_has_extrinsic = false;
+    bool                               m_register_depth = false;
+    std::unique_ptr<DepthRegistration> m_registration;
+
+    // ingest statistics
+    yarp::os::RpcServer m_stats_port;
 };
 #endif
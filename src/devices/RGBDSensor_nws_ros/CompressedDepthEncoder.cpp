@@ -0,0 +1,228 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "CompressedDepthEncoder.h"
+
+#include <cstring>
+
+#include <yarp/conf/compiler.h>
+
+#if defined(RGBD_ROS_HAS_ZLIB)
+#  include <zlib.h>
+#endif
+
+namespace {
+
+// value of ConfigHeader::format written by the plugin (INV_DEPTH)
+constexpr int32_t CONFIG_FORMAT_INV_DEPTH = 0;
+
+void putLE32(std::vector<std::uint8_t>& out, uint32_t v)
+{
+    out.push_back(static_cast<std::uint8_t>(v));
+    out.push_back(static_cast<std::uint8_t>(v >> 8));
+    out.push_back(static_cast<std::uint8_t>(v >> 16));
+    out.push_back(static_cast<std::uint8_t>(v >> 24));
+}
+
+#if defined(RGBD_ROS_HAS_ZLIB)
+void putBE32(std::uint8_t* out, uint32_t v)
+{
+    out[0] = static_cast<std::uint8_t>(v >> 24);
+    out[1] = static_cast<std::uint8_t>(v >> 16);
+    out[2] = static_cast<std::uint8_t>(v >> 8);
+    out[3] = static_cast<std::uint8_t>(v);
+}
+#endif
+
+// ConfigHeader of compressed_depth_image_transport: { int32 format; float depthParam[2]; }
+void putConfigHeader(std::vector<std::uint8_t>& out)
+{
+    putLE32(out, static_cast<uint32_t>(CONFIG_FORMAT_INV_DEPTH));
+    // depth quantization parameters, only used for 32FC1 images
+    putLE32(out, 0);
+    putLE32(out, 0);
+}
+
+// Packs the variable length codes of RVL, 8 nibbles per 32 bit little endian word
+class NibbleWriter
+{
+public:
+    explicit NibbleWriter(std::vector<std::uint8_t>& out) : m_out(out) {}
+
+    void encode(uint32_t value)
+    {
+        do {
+            uint32_t nibble = value & 0x7;
+            value >>= 3;
+            if (value != 0) {
+                nibble |= 0x8;
+            }
+            m_word = (m_word << 4) | nibble;
+            if (++m_nibbles == 8) {
+                putLE32(m_out, m_word);
+                m_nibbles = 0;
+                m_word = 0;
+            }
+        } while (value != 0);
+    }
+
+    void flush()
+    {
+        if (m_nibbles != 0) {
+            putLE32(m_out, m_word << (4 * (8 - m_nibbles)));
+            m_nibbles = 0;
+            m_word = 0;
+        }
+    }
+
+private:
+    std::vector<std::uint8_t>& m_out;
+    uint32_t                   m_word = 0;
+    int                        m_nibbles = 0;
+};
+
+} // namespace
+
+bool CompressedDepthEncoder::parseCodec(const std::string& name, Codec& codec)
+{
+    if (name == "rvl") {
+        codec = Codec::RVL;
+        return true;
+    }
+    if (name == "png") {
+        codec = Codec::PNG;
+        return true;
+    }
+    return false;
+}
+
+bool CompressedDepthEncoder::pngAvailable()
+{
+#if defined(RGBD_ROS_HAS_ZLIB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+CompressedDepthEncoder::CompressedDepthEncoder(Codec codec, int pngLevel) :
+        m_codec(codec),
+        m_pngLevel(pngLevel)
+{
+}
+
+bool CompressedDepthEncoder::encode(const std::uint16_t* depth, size_t width, size_t height, std::string& format, std::vector<std::uint8_t>& data)
+{
+    data.clear();
+    putConfigHeader(data);
+    if (m_codec == Codec::RVL) {
+        format = "16UC1; compressedDepth rvl";
+        encodeRvl(depth, width, height, data);
+        return true;
+    }
+    format = "16UC1; compressedDepth png";
+    return encodePng(depth, width, height, data);
+}
+
+void CompressedDepthEncoder::encodeRvl(const std::uint16_t* depth, size_t width, size_t height, std::vector<std::uint8_t>& data)
+{
+    putLE32(data, static_cast<uint32_t>(width));
+    putLE32(data, static_cast<uint32_t>(height));
+
+    // typical depth images shrink to a fourth, avoid most of the reallocations
+    data.reserve(data.size() + width * height / 2);
+
+    NibbleWriter writer(data);
+    const std::uint16_t* p = depth;
+    const std::uint16_t* end = depth + width * height;
+    int32_t previous = 0;
+    while (p != end) {
+        // a run of zeros (no measurement) followed by a run of valid samples, delta and zigzag coded
+        uint32_t zeros = 0;
+        for (; p != end && *p == 0; p++) {
+            zeros++;
+        }
+        writer.encode(zeros);
+        uint32_t nonzeros = 0;
+        for (const std::uint16_t* q = p; q != end && *q != 0; q++) {
+            nonzeros++;
+        }
+        writer.encode(nonzeros);
+        for (uint32_t i = 0; i < nonzeros; i++, p++) {
+            const int32_t current = *p;
+            const int32_t delta = current - previous;
+            writer.encode((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31));
+            previous = current;
+        }
+    }
+    writer.flush();
+}
+
+bool CompressedDepthEncoder::encodePng(const std::uint16_t* depth, size_t width, size_t height, std::vector<std::uint8_t>& data)
+{
+#if defined(RGBD_ROS_HAS_ZLIB)
+    // rows of big endian samples, each one prefixed by the "Sub" filter type: the difference with the
+    // left neighbour makes the smooth depth surfaces compress well even at the fastest levels
+    const size_t rowBytes = 1 + 2 * width;
+    m_scratch.resize(rowBytes * height);
+    for (size_t r = 0; r < height; r++) {
+        const std::uint16_t* src = depth + r * width;
+        std::uint8_t* dst = m_scratch.data() + r * rowBytes;
+        *dst++ = 1;
+        std::uint16_t left = 0;
+        for (size_t c = 0; c < width; c++) {
+            // PNG filters work on bytes: no borrow between the two bytes of a sample
+            dst[2 * c] = static_cast<std::uint8_t>((src[c] >> 8) - (left >> 8));
+            dst[2 * c + 1] = static_cast<std::uint8_t>(src[c] - left);
+            left = src[c];
+        }
+    }
+
+    static const std::uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    data.insert(data.end(), signature, signature + sizeof(signature));
+
+    // appends a chunk whose payload has already been written after its 8 bytes prefix
+    auto closeChunk = [&data](size_t start, const char* type) {
+        const size_t length = data.size() - start - 8;
+        putBE32(data.data() + start, static_cast<uint32_t>(length));
+        memcpy(data.data() + start + 4, type, 4);
+        uLong crc = crc32(0L, data.data() + start + 4, static_cast<uInt>(length + 4));
+        data.resize(data.size() + 4);
+        putBE32(data.data() + data.size() - 4, static_cast<uint32_t>(crc));
+    };
+
+    size_t start = data.size();
+    data.resize(start + 8 + 13);
+    std::uint8_t* ihdr = data.data() + start + 8;
+    putBE32(ihdr, static_cast<uint32_t>(width));
+    putBE32(ihdr + 4, static_cast<uint32_t>(height));
+    ihdr[8] = 16; // bit depth
+    ihdr[9] = 0;  // grayscale
+    ihdr[10] = 0; // deflate
+    ihdr[11] = 0; // adaptive filtering
+    ihdr[12] = 0; // no interlace
+    closeChunk(start, "IHDR");
+
+    start = data.size();
+    uLongf compressedSize = compressBound(static_cast<uLong>(m_scratch.size()));
+    data.resize(start + 8 + compressedSize);
+    if (compress2(data.data() + start + 8, &compressedSize, m_scratch.data(), static_cast<uLong>(m_scratch.size()), m_pngLevel) != Z_OK) {
+        return false;
+    }
+    data.resize(start + 8 + compressedSize);
+    closeChunk(start, "IDAT");
+
+    start = data.size();
+    data.resize(start + 8);
+    closeChunk(start, "IEND");
+    return true;
+#else
+    YARP_UNUSED(depth);
+    YARP_UNUSED(width);
+    YARP_UNUSED(height);
+    YARP_UNUSED(data);
+    return false;
+#endif
+}
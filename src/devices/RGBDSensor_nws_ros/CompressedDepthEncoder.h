@@ -0,0 +1,64 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef YARP_DEV_RGBDSENSOR_NWS_ROS_COMPRESSEDDEPTHENCODER_H
+#define YARP_DEV_RGBDSENSOR_NWS_ROS_COMPRESSEDDEPTHENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Encodes 16 bit depth images (millimetres) into the payload of the sensor_msgs/CompressedImage
+ * messages published by the `compressedDepth` plugin of image_transport, so that they can be
+ * decoded by the stock ROS subscribers.
+ *
+ * The payload is the 12 bytes configuration header of the plugin (ignored for 16UC1 images)
+ * followed by either:
+ *  - rvl: the image width and height as 32 bit integers and the RVL stream (A. D. Wilson,
+ *    "Fast Lossless Depth Image Compression", ISS 2017), very fast and usually ~4x smaller than raw;
+ *  - png: a 16 bit grayscale PNG image (available only if zlib was found at build time).
+ */
+class CompressedDepthEncoder
+{
+public:
+    enum class Codec
+    {
+        RVL,
+        PNG
+    };
+
+    /**
+     * Parses "rvl" or "png" into `codec`. Returns false for unknown names.
+     */
+    static bool parseCodec(const std::string& name, Codec& codec);
+
+    /**
+     * Whether the png codec was built in.
+     */
+    static bool pngAvailable();
+
+    /**
+     * @param pngLevel zlib compression level (1-9) used by the png codec, low levels are much faster
+     */
+    CompressedDepthEncoder(Codec codec, int pngLevel);
+
+    /**
+     * Replaces `data` with the encoding of the `width` x `height` image in `depth` (rows without padding),
+     * and sets `format` to the matching CompressedImage format string. Returns false on failure.
+     */
+    bool encode(const std::uint16_t* depth, size_t width, size_t height, std::string& format, std::vector<std::uint8_t>& data);
+
+private:
+    void encodeRvl(const std::uint16_t* depth, size_t width, size_t height, std::vector<std::uint8_t>& data);
+    bool encodePng(const std::uint16_t* depth, size_t width, size_t height, std::vector<std::uint8_t>& data);
+
+    Codec                     m_codec;
+    int                       m_pngLevel;
+    std::vector<std::uint8_t> m_scratch;
+};
+
+#endif // YARP_DEV_RGBDSENSOR_NWS_ROS_COMPRESSEDDEPTHENCODER_H
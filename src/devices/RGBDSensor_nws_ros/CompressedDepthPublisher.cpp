@@ -0,0 +1,122 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "CompressedDepthPublisher.h"
+
+#include <depthConversion.h>
+
+#include <cstring>
+#include <utility>
+
+namespace {
+// 16UC1 depth is in millimetres
+constexpr float METRES_TO_MILLIMETRES = 1000.0f;
+}
+
+CompressedDepthPublisher::CompressedDepthPublisher(CompressedDepthEncoder::Codec codec, int pngLevel) :
+        m_encoder(codec, pngLevel)
+{
+}
+
+CompressedDepthPublisher::~CompressedDepthPublisher()
+{
+    close();
+}
+
+bool CompressedDepthPublisher::open(const std::string& topic, const std::string& frameId)
+{
+    if (!m_publisher.topic(topic)) {
+        return false;
+    }
+    m_frameId = frameId;
+    m_stop = false;
+    m_thread = std::thread(&CompressedDepthPublisher::run, this);
+    return true;
+}
+
+void CompressedDepthPublisher::close()
+{
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+    m_publisher.close();
+}
+
+int CompressedDepthPublisher::getOutputCount()
+{
+    return m_publisher.getOutputCount();
+}
+
+void CompressedDepthPublisher::post(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth, const yarp::os::Stamp& stamp, unsigned int seq)
+{
+    const size_t width = depth.width();
+    const size_t height = depth.height();
+    m_staging.depth.resize(width * height);
+    for (size_t r = 0; r < height; r++) {
+        yarp::dev::RGBDRosConversionUtils::convertFloatDepthTo16U(reinterpret_cast<const float*>(depth.getRow(r)),
+                                                                   m_staging.depth.data() + r * width,
+                                                                   width,
+                                                                   METRES_TO_MILLIMETRES);
+    }
+    handOff(width, height, stamp, seq);
+}
+
+void CompressedDepthPublisher::post(const yarp::sig::ImageOf<yarp::sig::PixelMono16>& depthMm, const yarp::os::Stamp& stamp, unsigned int seq)
+{
+    const size_t width = depthMm.width();
+    const size_t height = depthMm.height();
+    m_staging.depth.resize(width * height);
+    for (size_t r = 0; r < height; r++) {
+        memcpy(m_staging.depth.data() + r * width, depthMm.getRow(r), width * sizeof(std::uint16_t));
+    }
+    handOff(width, height, stamp, seq);
+}
+
+void CompressedDepthPublisher::handOff(size_t width, size_t height, const yarp::os::Stamp& stamp, unsigned int seq)
+{
+    m_staging.width = width;
+    m_staging.height = height;
+    m_staging.stamp = stamp;
+    m_staging.seq = seq;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // an image still waiting for the encoder is simply replaced by the newer one
+        std::swap(m_staging, m_pending);
+        m_hasPending = true;
+    }
+    m_cv.notify_one();
+}
+
+void CompressedDepthPublisher::run()
+{
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || m_hasPending; });
+            if (m_stop) {
+                return;
+            }
+            std::swap(m_pending, m_encoding);
+            m_hasPending = false;
+        }
+
+        yarp::rosmsg::sensor_msgs::CompressedImage& msg = m_publisher.prepare();
+        msg.header.frame_id = m_frameId;
+        msg.header.seq = m_encoding.seq;
+        msg.header.stamp = m_encoding.stamp.getTime();
+        if (!m_encoder.encode(m_encoding.depth.data(), m_encoding.width, m_encoding.height, msg.format, msg.data)) {
+            m_publisher.unprepare();
+            continue;
+        }
+        m_publisher.setEnvelope(m_encoding.stamp);
+        m_publisher.write();
+    }
+}
@@ -0,0 +1,80 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef YARP_DEV_RGBDSENSOR_NWS_ROS_COMPRESSEDDEPTHPUBLISHER_H
+#define YARP_DEV_RGBDSENSOR_NWS_ROS_COMPRESSEDDEPTHPUBLISHER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <yarp/os/Publisher.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/rosmsg/sensor_msgs/CompressedImage.h>
+#include <yarp/sig/Image.h>
+
+#include "CompressedDepthEncoder.h"
+
+/**
+ * Publishes depth images on a `compressedDepth` topic without slowing down the capture thread.
+ *
+ * post() only quantizes the depth image to 16 bit millimetres (which also makes the copy handed to
+ * the encoder half the size of the float image), or copies it if it is already in millimetres, and
+ * wakes up the encoding thread, which encodes and
+ * writes the message. If the encoder is still busy when a new image is posted, the older image
+ * waiting to be encoded is replaced.
+ */
+class CompressedDepthPublisher
+{
+public:
+    CompressedDepthPublisher(CompressedDepthEncoder::Codec codec, int pngLevel);
+    CompressedDepthPublisher(const CompressedDepthPublisher&) = delete;
+    CompressedDepthPublisher& operator=(const CompressedDepthPublisher&) = delete;
+    ~CompressedDepthPublisher();
+
+    bool open(const std::string& topic, const std::string& frameId);
+    void close();
+
+    int getOutputCount();
+
+    void post(const yarp::sig::ImageOf<yarp::sig::PixelFloat>& depth, const yarp::os::Stamp& stamp, unsigned int seq);
+
+    /**
+     * Same as the float overload, for a depth image already quantized to 16 bit millimetres.
+     */
+    void post(const yarp::sig::ImageOf<yarp::sig::PixelMono16>& depthMm, const yarp::os::Stamp& stamp, unsigned int seq);
+
+private:
+    struct Frame
+    {
+        std::vector<std::uint16_t> depth;
+        size_t                     width = 0;
+        size_t                     height = 0;
+        yarp::os::Stamp            stamp;
+        unsigned int               seq = 0;
+    };
+
+    void handOff(size_t width, size_t height, const yarp::os::Stamp& stamp, unsigned int seq);
+    void run();
+
+    yarp::os::Publisher<yarp::rosmsg::sensor_msgs::CompressedImage> m_publisher;
+    CompressedDepthEncoder                                          m_encoder;
+    std::string                                                     m_frameId;
+
+    // filled by post(), swapped with the pending one and then with the one being encoded
+    Frame                   m_staging;
+    Frame                   m_pending;
+    Frame                   m_encoding;
+    bool                    m_hasPending = false;
+    bool                    m_stop = false;
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::thread             m_thread;
+};
+
+#endif // YARP_DEV_RGBDSENSOR_NWS_ROS_COMPRESSEDDEPTHPUBLISHER_H
@@ -0,0 +1,125 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef YARP_DEV_RGBDSENSOR_NWS_ROS_PUBLISHWORKER_H
+#define YARP_DEV_RGBDSENSOR_NWS_ROS_PUBLISHWORKER_H
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <yarp/os/Stamp.h>
+#include <yarp/rosmsg/sensor_msgs/CameraInfo.h>
+
+#include <frameHandoff.h>
+
+/**
+ * A grabbed image with everything needed to publish it, camera_info included, so that the publishing
+ * thread never calls into the sensor.
+ */
+template <typename Image>
+struct PublishFrame
+{
+    Image                                 image;
+    yarp::os::Stamp                       stamp;
+    unsigned int                          seq = 0;
+    yarp::rosmsg::sensor_msgs::CameraInfo camInfo;
+    bool                                  hasCamInfo = false;
+};
+
+/**
+ * Publishes the frames of one stream from its own thread.
+ *
+ * The capture thread fills a buffer obtained with acquire() and hands it off with post(); the worker
+ * thread publishes the latest posted frame, older frames not yet picked up are skipped. A buffer goes
+ * back to the pool only when the worker moves to the next frame, and the publish function must wait
+ * for the previous message to be sent before writing a new one (Publisher::waitForWrite()), so the
+ * capture thread never overwrites an image still referenced by a message being serialized.
+ *
+ * acquire() and post() must be called by a single thread. After stop(), the messages still being sent
+ * have to be waited for before posting again.
+ */
+template <typename Frame>
+class PublishWorker
+{
+public:
+    typedef std::function<void(const Frame&)> Publish;
+
+    PublishWorker() = default;
+    PublishWorker(const PublishWorker&) = delete;
+    PublishWorker& operator=(const PublishWorker&) = delete;
+
+    ~PublishWorker()
+    {
+        stop();
+    }
+
+    void start(Publish publish)
+    {
+        m_publish = std::move(publish);
+        m_stop = false;
+        m_hasNew = false;
+        m_thread = std::thread(&PublishWorker::run, this);
+    }
+
+    void stop()
+    {
+        if (m_thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            m_thread.join();
+        }
+    }
+
+    std::shared_ptr<Frame> acquire()
+    {
+        return m_frames.acquire();
+    }
+
+    void post(const std::shared_ptr<Frame>& frame)
+    {
+        m_frames.publish(frame);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_hasNew = true;
+        }
+        m_cv.notify_one();
+    }
+
+private:
+    void run()
+    {
+        std::shared_ptr<const Frame> current;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_stop || m_hasNew; });
+                if (m_stop) {
+                    return;
+                }
+                m_hasNew = false;
+            }
+            std::shared_ptr<const Frame> frame = m_frames.latest();
+            m_publish(*frame);
+            // the previous message was sent before the new one was written: its buffer can be reused
+            current = std::move(frame);
+        }
+    }
+
+    yarp::dev::RGBDRosConversionUtils::FrameHandoff<Frame> m_frames;
+    Publish                                                m_publish;
+    bool                                                   m_hasNew = false;
+    bool                                                   m_stop = false;
+    std::mutex                                             m_mutex;
+    std::condition_variable                                m_cv;
+    std::thread                                            m_thread;
+};
+
+#endif // YARP_DEV_RGBDSENSOR_NWS_ROS_PUBLISHWORKER_H
@@ -12,6 +12,8 @@
 #include <yarp/rosmsg/impl/yarpRosHelper.h>
 
 #include <RGBDRosConversionUtils.h>
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <sstream>
@@ -69,19 +71,150 @@ bool RgbdSensor_nws_ros::open(yarp::os::Searchable &config)
         forceInfoSync = config.find("forceInfoSync").asBool();
     }
 
+    if (config.check("publish_only_new_frames"))
+    {
+        m_publishOnlyNewFrames = config.find("publish_only_new_frames").asBool();
+    }
+
+    if (config.check("lazy_capture"))
+    {
+        m_lazyCapture = config.find("lazy_capture").asBool();
+    }
+
+    if (config.check("pipelined_publish"))
+    {
+        m_pipelined = config.find("pipelined_publish").asBool();
+    }
+
+    if (config.check("roi"))
+    {
+        Bottle* roi = config.find("roi").asList();
+        if (roi == nullptr || roi->size() != 4)
+        {
+            yCError(RGBDSENSORNWSROS) << "roi must be a list of four values (x y width height)";
+            return false;
+        }
+        for (size_t i = 0; i < 4; i++)
+        {
+            if (roi->get(i).asInt32() < 0)
+            {
+                yCError(RGBDSENSORNWSROS) << "roi values cannot be negative";
+                return false;
+            }
+        }
+        m_outputWindow.x = static_cast<size_t>(roi->get(0).asInt32());
+        m_outputWindow.y = static_cast<size_t>(roi->get(1).asInt32());
+        m_outputWindow.width = static_cast<size_t>(roi->get(2).asInt32());
+        m_outputWindow.height = static_cast<size_t>(roi->get(3).asInt32());
+    }
+
+    if (config.check("output_scale"))
+    {
+        // only integer shrink factors are supported, i.e. 1, 1/2, 1/3, ...
+        const double scale = config.find("output_scale").asFloat64();
+        const double factor = scale > 0 ? std::round(1.0 / scale) : 0;
+        if (scale <= 0 || scale > 1 || std::fabs(factor * scale - 1.0) > 1e-3)
+        {
+            yCError(RGBDSENSORNWSROS) << "output_scale must be 1/N, with N a positive integer (e.g. 1, 0.5, 0.25)";
+            return false;
+        }
+        m_outputWindow.decimation = static_cast<size_t>(factor);
+    }
+    m_outputWindow.minDepthPooling = true;
+
+    if (config.check("depth_encoding"))
+    {
+        const std::string encoding = config.find("depth_encoding").asString();
+        if (encoding != TYPE_32FC1 && encoding != TYPE_16UC1)
+        {
+            yCError(RGBDSENSORNWSROS) << "Invalid depth_encoding" << encoding << "(valid values: 32FC1, 16UC1)";
+            return false;
+        }
+        m_depth16UC1 = encoding == TYPE_16UC1;
+    }
+
+    if (config.check("depth_compression"))
+    {
+        const std::string codecName = config.find("depth_compression").asString();
+        if (codecName != "none")
+        {
+            CompressedDepthEncoder::Codec codec;
+            if (!CompressedDepthEncoder::parseCodec(codecName, codec))
+            {
+                yCError(RGBDSENSORNWSROS) << "Invalid depth_compression" << codecName << "(valid values: none, rvl, png)";
+                return false;
+            }
+            if (codec == CompressedDepthEncoder::Codec::PNG && !CompressedDepthEncoder::pngAvailable())
+            {
+                yCError(RGBDSENSORNWSROS) << "depth_compression png is not available: the device was built without zlib";
+                return false;
+            }
+            const int pngLevel = config.check("depth_png_level") ? config.find("depth_png_level").asInt32() : 1;
+            if (pngLevel < 1 || pngLevel > 9)
+            {
+                yCError(RGBDSENSORNWSROS) << "depth_png_level must be in [1, 9]";
+                return false;
+            }
+            m_compressedDepth = std::make_unique<CompressedDepthPublisher>(codec, pngLevel);
+        }
+    }
+
+    if (config.check("jpeg_compression") && config.find("jpeg_compression").asBool())
+    {
+        if (!yarp::dev::RosImageCompression::JpegEncoder::available())
+        {
+            yCError(RGBDSENSORNWSROS) << "jpeg_compression is not available: the device was built without libjpeg";
+            return false;
+        }
+        const int quality = config.check("jpeg_quality") ? config.find("jpeg_quality").asInt32() : 80;
+        if (quality < 1 || quality > 100)
+        {
+            yCError(RGBDSENSORNWSROS) << "jpeg_quality must be in [1, 100]";
+            return false;
+        }
+        const int threads = config.check("jpeg_threads") ? config.find("jpeg_threads").asInt32() : 2;
+        if (threads < 1)
+        {
+            yCError(RGBDSENSORNWSROS) << "jpeg_threads must be at least 1";
+            return false;
+        }
+        m_compressedColor = std::make_unique<yarp::dev::RosImageCompression::CompressedImagePublisher>(quality, static_cast<size_t>(threads));
+    }
+
+    if (config.check("caminfo_refresh_period"))
+    {
+        m_camInfoRefreshPeriod = config.find("caminfo_refresh_period").asFloat64();
+    }
+
     if(!initialize_ROS(config))
     {
         return false;
     }
 
+    if (config.check("stats_port_name")) {
+        std::string stats_port_name = config.find("stats_port_name").asString();
+        if (!m_stats_port.open(stats_port_name)) {
+            yCError(RGBDSENSORNWSROS) << "Failed to open port" << stats_port_name;
+            // releases the publishers and the node created above
+            close();
+            return false;
+        }
+        m_stats_port.setReader(*this);
+    }
+
     return true;
 }
 
 bool RgbdSensor_nws_ros::close()
 {
     yCTrace(RGBDSENSORNWSROS, "Close");
+    m_stats_port.close();
     detach();
 
+    // the publishers have to be closed before the node
+    m_compressedDepth.reset();
+    m_compressedColor.reset();
+
     if(m_node !=nullptr)
     {
         m_node->interrupt();
@@ -171,6 +304,27 @@ bool RgbdSensor_nws_ros::initialize_ROS(yarp::os::Searchable &params)
         yCError(RGBDSENSORNWSROS) << "Unable to publish data on " << depth_info_topic_name.c_str() << " topic, check your yarp-ROS network configuration";
         return false;
     }
+
+    // same names used by the compressed and compressedDepth plugins of image_transport
+    if (m_compressedColor)
+    {
+        std::string compressed_topic_name = color_topic_name + "/compressed";
+        if (!m_compressedColor->open(compressed_topic_name, m_color_frame_id))
+        {
+            yCError(RGBDSENSORNWSROS) << "Unable to publish data on " << compressed_topic_name.c_str() << " topic, check your yarp-ROS network configuration";
+            return false;
+        }
+    }
+
+    if (m_compressedDepth)
+    {
+        std::string compressed_topic_name = depth_topic_name + "/compressedDepth";
+        if (!m_compressedDepth->open(compressed_topic_name, m_depth_frame_id))
+        {
+            yCError(RGBDSENSORNWSROS) << "Unable to publish data on " << compressed_topic_name.c_str() << " topic, check your yarp-ROS network configuration";
+            return false;
+        }
+    }
     return true;
 }
 
@@ -207,6 +361,10 @@ bool RgbdSensor_nws_ros::attach(PolyDriver* poly)
         yCWarning(RGBDSENSORNWSROS) << "Attached device has no valid IFrameGrabberControls interface.";
     }
 
+    // the camera_info messages are prepared once here and only stamped for every frame
+    updateCamInfo(COLOR_SENSOR);
+    updateCamInfo(DEPTH_SENSOR);
+
     PeriodicThread::setPeriod(period);
     return PeriodicThread::start();
 }
@@ -216,12 +374,30 @@ bool RgbdSensor_nws_ros::attach(PolyDriver* poly)
 bool RgbdSensor_nws_ros::threadInit()
 {
     // Get interface from attached device if any.
+    // With pipelined_publish, one publishing thread per stream, fed by writeData()
+    if (m_pipelined)
+    {
+        m_colorWorker.start([this](const ColorFrame& frame) {
+            publishColor(frame.image, frame.stamp, frame.seq, frame.hasCamInfo ? &frame.camInfo : nullptr);
+        });
+        m_depthWorker.start([this](const DepthFrame& frame) {
+            publishDepth(frame.image, frame.stamp, frame.seq, frame.hasCamInfo ? &frame.camInfo : nullptr);
+        });
+    }
     return true;
 }
 
 void RgbdSensor_nws_ros::threadRelease()
 {
     // Detach() calls stop() which in turns calls this functions, therefore no calls to detach here!
+
+    m_colorWorker.stop();
+    m_depthWorker.stop();
+
+    // Pending messages still reference the grabbed images (colorImage and depthImage, or the buffers of
+    // the publishing threads)
+    publisherPort_color.waitForWrite();
+    publisherPort_depth.waitForWrite();
 }
 
 bool RgbdSensor_nws_ros::setCamInfo(yarp::rosmsg::sensor_msgs::CameraInfo& cameraInfo, const std::string& frame_id, const UInt& seq, const SensorType& sensorType)
@@ -333,9 +509,156 @@ bool RgbdSensor_nws_ros::setCamInfo(yarp::rosmsg::sensor_msgs::CameraInfo& camer
     cameraInfo.binning_x  = cameraInfo.binning_y = 0;
     cameraInfo.roi.height = cameraInfo.roi.width = cameraInfo.roi.x_offset = cameraInfo.roi.y_offset = 0;
     cameraInfo.roi.do_rectify = false;
+
+    // As ROS expects, K and P stay the full resolution ones: the published window is described by
+    // roi (in full resolution pixels) and binning, which image_geometry applies to the intrinsics
+    size_t x0 = 0;
+    size_t y0 = 0;
+    size_t outWidth = 0;
+    size_t outHeight = 0;
+    if (!m_outputWindow.isIdentity() && m_outputWindow.resolve(cameraInfo.width, cameraInfo.height, x0, y0, outWidth, outHeight))
+    {
+        const size_t decimation = std::max<size_t>(m_outputWindow.decimation, 1);
+        cameraInfo.binning_x = cameraInfo.binning_y = decimation > 1 ? decimation : 0;
+        cameraInfo.roi.x_offset = x0;
+        cameraInfo.roi.y_offset = y0;
+        cameraInfo.roi.width = outWidth * decimation;
+        cameraInfo.roi.height = outHeight * decimation;
+    }
     return true;
 }
 
+void RgbdSensor_nws_ros::updateCamInfo(const SensorType& sensorType)
+{
+    CamInfoCache& cache = sensorType == COLOR_SENSOR ? m_colorCamInfo : m_depthCamInfo;
+    const std::string& frame_id = sensorType == COLOR_SENSOR ? m_color_frame_id : m_depth_frame_id;
+    cache.lastUpdate = yarp::os::Time::now();
+    cache.valid = setCamInfo(cache.msg, frame_id, 0, sensorType);
+}
+
+const yarp::rosmsg::sensor_msgs::CameraInfo* RgbdSensor_nws_ros::getCamInfo(const SensorType& sensorType, size_t width, size_t height)
+{
+    CamInfoCache& cache = sensorType == COLOR_SENSOR ? m_colorCamInfo : m_depthCamInfo;
+    const double elapsed = yarp::os::Time::now() - cache.lastUpdate;
+
+    // rebuilt when missing (e.g. the sensor had no intrinsics yet at attach time), when the image size
+    // changed and periodically if requested, but never more than once per second
+    constexpr double minUpdatePeriod = 1.0;
+    const bool stale = !cache.valid ||
+                       cache.msg.width != width ||
+                       cache.msg.height != height ||
+                       (m_camInfoRefreshPeriod > 0 && elapsed >= m_camInfoRefreshPeriod);
+    if (stale && elapsed >= minUpdatePeriod)
+    {
+        updateCamInfo(sensorType);
+    }
+    return cache.valid ? &cache.msg : nullptr;
+}
+
+void RgbdSensor_nws_ros::publishColor(const yarp::sig::FlexImage& image, const yarp::os::Stamp& stamp, UInt seq, const yarp::rosmsg::sensor_msgs::CameraInfo* camInfo)
+{
+    // the previous message may still reference colorImageOut or the previous image
+    publisherPort_color.waitForWrite();
+
+    const yarp::sig::FlexImage* color = &image;
+    if (!m_outputWindow.isIdentity())
+    {
+        if (!yarp::dev::RGBDRosConversionUtils::resampleColor(image, m_outputWindow, colorImageOut))
+        {
+            yCWarningThrottle(RGBDSENSORNWSROS, 5, "roi/output_scale cannot be applied to the color image (empty window or unsupported pixel format)");
+            return;
+        }
+        color = &colorImageOut;
+    }
+
+    yarp::dev::RGBDRosConversionUtils::ImageWire& rColorImage = publisherPort_color.prepare();
+    yarp::rosmsg::TickTime                 cRosStamp       = stamp.getTime();
+    yarp::dev::RGBDRosConversionUtils::shallowCopyImages(*color, rColorImage, m_color_frame_id, cRosStamp, seq);
+    publisherPort_color.setEnvelope(stamp);
+    publisherPort_color.write();
+    if (m_compressedColor && m_compressedColor->getOutputCount() > 0)
+    {
+        // encoded and sent by the publisher own threads
+        if (!m_compressedColor->post(*color, stamp, seq))
+        {
+            yCWarningThrottle(RGBDSENSORNWSROS, 5, "The pixel format of the color image is not supported by the jpeg encoder");
+        }
+    }
+    if (camInfo)
+    {
+        yarp::rosmsg::sensor_msgs::CameraInfo& camInfoC = publisherPort_colorCaminfo.prepare();
+        camInfoC = *camInfo;
+        camInfoC.header.seq = seq;
+        if(forceInfoSync)
+            {camInfoC.header.stamp = rColorImage.header.stamp;}
+        publisherPort_colorCaminfo.setEnvelope(stamp);
+        publisherPort_colorCaminfo.write();
+    }
+    else
+    {
+        yCWarningThrottle(RGBDSENSORNWSROS, 5, "Missing color camera parameters... camera info messages will be not sent");
+    }
+}
+
+void RgbdSensor_nws_ros::publishDepth(const DepthImage& image, const yarp::os::Stamp& stamp, UInt seq, const yarp::rosmsg::sensor_msgs::CameraInfo* camInfo)
+{
+    // the previous message may still reference depthImageOut, depthImageMm or the previous image
+    publisherPort_depth.waitForWrite();
+
+    const DepthImage* depth = &image;
+    if (!m_outputWindow.isIdentity())
+    {
+        if (!yarp::dev::RGBDRosConversionUtils::resampleDepth(image, m_outputWindow, depthImageOut))
+        {
+            yCWarningThrottle(RGBDSENSORNWSROS, 5, "roi/output_scale cannot be applied to the depth image (empty window)");
+            return;
+        }
+        depth = &depthImageOut;
+    }
+
+    yarp::dev::RGBDRosConversionUtils::ImageWire& rDepthImage = publisherPort_depth.prepare();
+    yarp::rosmsg::TickTime                 dRosStamp       = stamp.getTime();
+    if (m_depth16UC1)
+    {
+        // converted during the copy, the message then references the millimetres image
+        yarp::dev::RGBDRosConversionUtils::depthToMillimetres(*depth, depthImageMm);
+        yarp::dev::RGBDRosConversionUtils::shallowCopyImages(depthImageMm, rDepthImage, m_depth_frame_id, dRosStamp, seq);
+        rDepthImage.encoding = TYPE_16UC1;
+    }
+    else
+    {
+        yarp::dev::RGBDRosConversionUtils::shallowCopyImages(*depth, rDepthImage, m_depth_frame_id, dRosStamp, seq);
+    }
+    publisherPort_depth.setEnvelope(stamp);
+    publisherPort_depth.write();
+    if (m_compressedDepth && m_compressedDepth->getOutputCount() > 0)
+    {
+        // encoded and sent by the publisher own thread, reusing the millimetres image if there is one
+        if (m_depth16UC1)
+        {
+            m_compressedDepth->post(depthImageMm, stamp, seq);
+        }
+        else
+        {
+            m_compressedDepth->post(*depth, stamp, seq);
+        }
+    }
+    if (camInfo)
+    {
+        yarp::rosmsg::sensor_msgs::CameraInfo& camInfoD = publisherPort_depthCaminfo.prepare();
+        camInfoD = *camInfo;
+        camInfoD.header.seq = seq;
+        if(forceInfoSync)
+            {camInfoD.header.stamp = rDepthImage.header.stamp;}
+        publisherPort_depthCaminfo.setEnvelope(stamp);
+        publisherPort_depthCaminfo.write();
+    }
+    else
+    {
+        yCWarningThrottle(RGBDSENSORNWSROS, 5, "Missing depth camera parameters... camera info messages will be not sent");
+    }
+}
+
 bool RgbdSensor_nws_ros::writeData()
 {
     //colorImage.setPixelCode(VOCAB_PIXEL_RGB);
@@ -343,69 +666,105 @@ bool RgbdSensor_nws_ros::writeData()
 
     //             colorImage.resize(hDim, vDim);  // Has this to be done each time? If size is the same what it does?
     //             depthImage.resize(hDim, vDim);
-    if (!sensor_p->getImages(colorImage, depthImage, &colorStamp, &depthStamp))
+
+    // The messages published in the previous cycle are serialized straight from colorImage and
+    // depthImage: wait until they are sent before grabbing new frames into the same buffers.
+    // The publishing threads of pipelined_publish are given buffers that no message references instead.
+    if (!m_pipelined)
     {
-        return false;
+        publisherPort_color.waitForWrite();
+        publisherPort_depth.waitForWrite();
     }
 
-    static Stamp oldColorStamp = Stamp(0, 0);
-    static Stamp oldDepthStamp = Stamp(0, 0);
-    bool rgb_data_ok = true;
-    bool depth_data_ok = true;
+    // nothing is grabbed or published for the streams nobody is listening to
+    const bool compressedColorWanted = m_compressedColor && m_compressedColor->getOutputCount() > 0;
+    const bool colorWanted = publisherPort_color.getOutputCount() > 0 || publisherPort_colorCaminfo.getOutputCount() > 0 || compressedColorWanted;
+    const bool compressedDepthWanted = m_compressedDepth && m_compressedDepth->getOutputCount() > 0;
+    const bool depthWanted = publisherPort_depth.getOutputCount() > 0 || publisherPort_depthCaminfo.getOutputCount() > 0 || compressedDepthWanted;
+    if (!colorWanted && !depthWanted)
+    {
+        return true;
+    }
+
+    std::shared_ptr<ColorFrame> colorFrame;
+    std::shared_ptr<DepthFrame> depthFrame;
+    yarp::sig::FlexImage* color = &colorImage;
+    DepthImage* depth = &depthImage;
+    if (m_pipelined)
+    {
+        colorFrame = m_colorWorker.acquire();
+        depthFrame = m_depthWorker.acquire();
+        color = &colorFrame->image;
+        depth = &depthFrame->image;
+    }
 
-    if (((colorStamp.getTime() - oldColorStamp.getTime()) > 0) == false)
+    bool grabbed = false;
+    if (m_lazyCapture && !depthWanted)
+    {
+        grabbed = sensor_p->getRgbImage(*color, &colorStamp);
+    }
+    else if (m_lazyCapture && !colorWanted)
+    {
+        grabbed = sensor_p->getDepthImage(*depth, &depthStamp);
+    }
+    else
     {
-        rgb_data_ok=false;
-        //return true;
+        grabbed = sensor_p->getImages(*color, *depth, &colorStamp, &depthStamp);
+    }
+    if (!grabbed)
+    {
+        return false;
     }
-    else { oldColorStamp = colorStamp; }
 
-    if (((depthStamp.getTime() - oldDepthStamp.getTime()) > 0) == false)
+    // frames whose stamp did not change since the previous cycle have already been published
+    const uint64_t duplicates = m_colorFrames.duplicates() + m_depthFrames.duplicates();
+    bool rgb_data_ok = colorWanted && (m_colorFrames.isNew(colorStamp) || !m_publishOnlyNewFrames);
+    bool depth_data_ok = depthWanted && (m_depthFrames.isNew(depthStamp) || !m_publishOnlyNewFrames);
+    if (m_colorFrames.duplicates() + m_depthFrames.duplicates() != duplicates)
     {
-        depth_data_ok=false;
-        //return true;
+        yCDebugThrottle(RGBDSENSORNWSROS, 30, "Frames with an unchanged stamp so far: %llu color, %llu depth",
+                        static_cast<unsigned long long>(m_colorFrames.duplicates()),
+                        static_cast<unsigned long long>(m_depthFrames.duplicates()));
     }
-    else { oldDepthStamp = depthStamp; }
 
     // TBD: We should check here somehow if the timestamp was correctly updated and, if not, update it ourselves.
+    // camera_info is refreshed here, so that only this thread calls into the sensor
     if (rgb_data_ok)
     {
-        yarp::rosmsg::sensor_msgs::Image&      rColorImage     = publisherPort_color.prepare();
-        yarp::rosmsg::sensor_msgs::CameraInfo& camInfoC        = publisherPort_colorCaminfo.prepare();
-        yarp::rosmsg::TickTime                 cRosStamp       = colorStamp.getTime();
-        yarp::dev::RGBDRosConversionUtils::deepCopyImages(colorImage, rColorImage, m_color_frame_id, cRosStamp, nodeSeq);
-        publisherPort_color.setEnvelope(colorStamp);
-        publisherPort_color.write();
-        if (setCamInfo(camInfoC, m_color_frame_id, nodeSeq, COLOR_SENSOR))
+        const auto* camInfo = getCamInfo(COLOR_SENSOR, color->width(), color->height());
+        if (m_pipelined)
         {
-            if(forceInfoSync)
-                {camInfoC.header.stamp = rColorImage.header.stamp;}
-            publisherPort_colorCaminfo.setEnvelope(colorStamp);
-            publisherPort_colorCaminfo.write();
+            colorFrame->stamp = colorStamp;
+            colorFrame->seq = nodeSeq;
+            colorFrame->hasCamInfo = camInfo != nullptr;
+            if (camInfo)
+            {
+                colorFrame->camInfo = *camInfo;
+            }
+            m_colorWorker.post(colorFrame);
         }
         else
         {
-            yCWarning(RGBDSENSORNWSROS, "Missing color camera parameters... camera info messages will be not sent");
+            publishColor(colorImage, colorStamp, nodeSeq, camInfo);
         }
     }
     if (depth_data_ok)
     {
-        yarp::rosmsg::sensor_msgs::Image&      rDepthImage     = publisherPort_depth.prepare();
-        yarp::rosmsg::sensor_msgs::CameraInfo& camInfoD        = publisherPort_depthCaminfo.prepare();
-        yarp::rosmsg::TickTime                 dRosStamp       = depthStamp.getTime();
-        yarp::dev::RGBDRosConversionUtils::deepCopyImages(depthImage, rDepthImage, m_depth_frame_id, dRosStamp, nodeSeq);
-        publisherPort_depth.setEnvelope(depthStamp);
-        publisherPort_depth.write();
-        if (setCamInfo(camInfoD, m_depth_frame_id, nodeSeq, DEPTH_SENSOR))
+        const auto* camInfo = getCamInfo(DEPTH_SENSOR, depth->width(), depth->height());
+        if (m_pipelined)
         {
-            if(forceInfoSync)
-                {camInfoD.header.stamp = rDepthImage.header.stamp;}
-            publisherPort_depthCaminfo.setEnvelope(depthStamp);
-            publisherPort_depthCaminfo.write();
+            depthFrame->stamp = depthStamp;
+            depthFrame->seq = nodeSeq;
+            depthFrame->hasCamInfo = camInfo != nullptr;
+            if (camInfo)
+            {
+                depthFrame->camInfo = *camInfo;
+            }
+            m_depthWorker.post(depthFrame);
         }
         else
         {
-            yCWarning(RGBDSENSORNWSROS, "Missing depth camera parameters... camera info messages will be not sent");
+            publishDepth(depthImage, depthStamp, nodeSeq, camInfo);
         }
     }
 
@@ -414,11 +773,56 @@ bool RgbdSensor_nws_ros::writeData()
     return true;
 }
 
+bool RgbdSensor_nws_ros::read(yarp::os::ConnectionReader& connection)
+{
+    yarp::os::Bottle command;
+    yarp::os::Bottle reply;
+    bool ok = command.read(connection);
+    if (!ok) {
+        return false;
+    }
+
+    reply.clear();
+
+    const std::string cmd = command.get(0).asString();
+    if (cmd == "help")
+    {
+        reply.addVocab32("many");
+        reply.addString("stats: returns the number of color and depth frames returned again by the sensor (unchanged stamp)");
+    }
+    else if (cmd == "stats")
+    {
+        yarp::os::Bottle& color = reply.addList();
+        color.addString("color");
+        yarp::os::Bottle& colorDuplicates = color.addList();
+        colorDuplicates.addString("duplicates");
+        colorDuplicates.addInt64(static_cast<int64_t>(m_colorFrames.duplicates()));
+        yarp::os::Bottle& depth = reply.addList();
+        depth.addString("depth");
+        yarp::os::Bottle& depthDuplicates = depth.addList();
+        depthDuplicates.addString("duplicates");
+        depthDuplicates.addInt64(static_cast<int64_t>(m_depthFrames.duplicates()));
+    }
+    else
+    {
+        yCError(RGBDSENSORNWSROS) << "Invalid command. Try `help`";
+        reply.addVocab32(VOCAB_ERR);
+    }
+
+    yarp::os::ConnectionWriter* returnToSender = connection.getWriter();
+    if (returnToSender != nullptr)
+    {
+        reply.write(*returnToSender);
+    }
+
+    return true;
+}
+
 void RgbdSensor_nws_ros::run()
 {
     if (sensor_p!=nullptr)
     {
-        static int i = 0;
+        int& i = m_notReadyCount;
         sensorStatus = sensor_p->getSensorStatus();
         switch (sensorStatus)
         {
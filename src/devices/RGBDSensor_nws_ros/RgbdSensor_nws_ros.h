@@ -8,6 +8,7 @@
 
 #include <vector>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <sstream>
 
@@ -17,6 +18,8 @@
 #include <yarp/os/Network.h>
 #include <yarp/os/Property.h>
 #include <yarp/os/PeriodicThread.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/RpcServer.h>
 
 #include <yarp/sig/Vector.h>
 
@@ -33,6 +36,15 @@
 #include <yarp/rosmsg/sensor_msgs/CameraInfo.h>
 #include <yarp/rosmsg/sensor_msgs/Image.h>
 
+#include <RGBDRosConversionUtils.h>
+#include <frameChangeDetector.h>
+#include <rosImageWire.h>
+
+#include <compressedImagePublisher.h>
+
+#include "CompressedDepthPublisher.h"
+#include "PublishWorker.h"
+
 #define DEFAULT_THREAD_PERIOD   0.03 // s
 
 namespace RGBDImpl
@@ -61,11 +73,24 @@ namespace RGBDImpl
  * |:----------------------:|:-----------------------:|:-------:|:--------------:|:-------------:|:------------------------------: |:---------------------------------------------------------------------------------------------------:|:-----:|
  * | period                 |      -                  | double  | s              |   0.03        |  No                             | refresh period of the broadcasted values in s                                                       | default 0.03s |
  * | forceInfoSync          |      -                  | string  | bool           |   -           |  no                             | set 'true' to force the timestamp on the camera_info message to match the image one                 |  - |
+ * | publish_only_new_frames |      -                 | bool    | -              |   true        |  no                             | if 'true' the frames returned again by the sensor (same stamp as the previous one) are not published | set to 'false' for sensors that do not update the stamps |
+ * | lazy_capture           |      -                  | bool    | -              |   false       |  no                             | if 'true' and only one of the color/depth streams has subscribers, only that image is grabbed (getRgbImage()/getDepthImage() instead of getImages()) | streams without subscribers are never published |
+ * | pipelined_publish      |      -                  | bool    | -              |   false       |  no                             | if 'true' the color and depth images grabbed by each getImages() call are published by two dedicated threads | depth latency no longer depends on the color resolution; when a thread is still busy, its stream skips to the latest frame |
+ * | roi                    |      -                  | list    | pixels         |   -           |  no                             | (x y width height) window of the color and depth images to publish, 0 width/height mean up to the image border | applied to both images before output_scale; the camera_info messages carry it in their roi field |
+ * | output_scale           |      -                  | double  | -              |   1           |  no                             | scale of the published images, 1/N with N integer: color is area averaged and depth min pooled on NxN blocks | camera_info messages keep the full resolution intrinsics and set binning_x/binning_y to N |
+ * | depth_encoding         |      -                  | string  | -              |   32FC1       |  no                             | encoding of the depth topic: 32FC1 (metres) or 16UC1 (millimetres, 0 for invalid samples)          | 16UC1 halves the bandwidth, with 1 mm resolution and 65.535 m range |
+ * | depth_compression      |      -                  | string  | -              |   none        |  no                             | codec of the additional <depth_topic_name>/compressedDepth topic: none, rvl or png (png requires zlib) | compatible with the compressedDepth plugin of image_transport; depth is quantized to 16 bit millimetres and encoded by a separate thread |
+ * | depth_png_level        |      -                  | int     | -              |   1           |  no                             | zlib compression level (1-9) of the png codec                                                       | higher levels are much slower for a small gain |
+ * | jpeg_compression       |      -                  | bool    | -              |   false       |  no                             | if 'true' the color images are also published as jpeg on <color_topic_name>/compressed (requires libjpeg) | compatible with the compressed plugin of image_transport; frames are encoded only while the topic has subscribers |
+ * | jpeg_quality           |      -                  | int     | -              |   80          |  no                             | jpeg quality (1-100)                                                                                |  - |
+ * | jpeg_threads           |      -                  | int     | -              |   2           |  no                             | number of threads encoding the jpeg images                                                          | consecutive frames are encoded concurrently |
+ * | caminfo_refresh_period |      -                  | double  | s              |   0           |  no                             | period of the refresh of the camera_info messages from the sensor intrinsics                        | 0: refreshed only at attach and when the image size changes |
  * | color_topic_name       |      -                  | string  | -              |   -           |  Yes                            | the color topic                                                                                     | recommended value /camera/color/image_rect_color  |
  * | depth_topic_name       |      -                  | string  | -              |   -           |  Yes                            | the depth topic                                                                                     | recommended value /camera/depth/image_rect  |
  * | color_frame_id         |      -                  | string  |  -             |   -           |  Yes                            | set the name of the reference frame for the color camera                                            |                               |
  * | depth_frame_id         |      -                  | string  |  -             |   -           |  Yes                            | set the name of the reference frame for the depth camera                                            |                               |
  * | node_name              |      -                  | string  |  -             |   -           |  Yes                            | set the name for ROS node                                                                           | must start with a leading '/' |
+ * | stats_port_name        |      -                  | string  | -              |   -           |  no                             | if set, an rpc port with this name answers `stats` (frames returned again by the sensor, per stream) and `help` | -                                                           |
  *
  * ROS message type used is sensor_msgs/Image.msg ( http://docs.ros.org/api/sensor_msgs/html/msg/Image.html)
  * Some example of configuration files:
@@ -87,11 +112,12 @@ namespace RGBDImpl
 class RgbdSensor_nws_ros :
         public yarp::dev::DeviceDriver,
         public yarp::dev::WrapperSingle,
-        public yarp::os::PeriodicThread
+        public yarp::os::PeriodicThread,
+        public yarp::os::PortReader
 {
 private:
     typedef yarp::sig::ImageOf<yarp::sig::PixelFloat>    DepthImage;
-    typedef yarp::os::Publisher<yarp::rosmsg::sensor_msgs::Image>       ImageTopicType;
+    typedef yarp::os::Publisher<yarp::dev::RGBDRosConversionUtils::ImageWire> ImageTopicType;
     typedef yarp::os::Publisher<yarp::rosmsg::sensor_msgs::CameraInfo>  DepthTopicType;
     typedef unsigned int                                 UInt;
 
@@ -119,6 +145,9 @@ private:
     std::string           m_depth_frame_id;
     yarp::sig::FlexImage  colorImage;
     DepthImage            depthImage;
+    yarp::sig::ImageOf<yarp::sig::PixelMono16> depthImageMm;
+    yarp::sig::FlexImage  colorImageOut;
+    DepthImage            depthImageOut;
     UInt                  nodeSeq;
 
     // Image data specs
@@ -135,12 +164,54 @@ private:
     // Synch
     yarp::os::Stamp                colorStamp;
     yarp::os::Stamp                depthStamp;
+    yarp::dev::RGBDRosConversionUtils::FrameChangeDetector m_colorFrames;
+    yarp::dev::RGBDRosConversionUtils::FrameChangeDetector m_depthFrames;
+    yarp::os::RpcServer            m_stats_port;
+    bool                           m_publishOnlyNewFrames = true;
+    int                            m_notReadyCount = 0;
+
+    // camera_info messages, built from the sensor intrinsics only when needed
+    struct CamInfoCache
+    {
+        yarp::rosmsg::sensor_msgs::CameraInfo msg;
+        bool                                  valid = false;
+        double                                lastUpdate = 0;
+    };
+    CamInfoCache                   m_colorCamInfo;
+    CamInfoCache                   m_depthCamInfo;
+    double                         m_camInfoRefreshPeriod = 0;
+
+    // grab only the stream(s) with subscribers instead of the synchronized pair
+    bool                           m_lazyCapture = false;
+
+    // publish color and depth from their own threads (pipelined_publish)
+    typedef PublishFrame<yarp::sig::FlexImage> ColorFrame;
+    typedef PublishFrame<DepthImage>           DepthFrame;
+    bool                           m_pipelined = false;
+    PublishWorker<ColorFrame>      m_colorWorker;
+    PublishWorker<DepthFrame>      m_depthWorker;
+
+    // crop and downscaling of the published images (roi, output_scale)
+    yarp::dev::RGBDRosConversionUtils::IngestWindow m_outputWindow;
+
+    // publish depth as 16UC1 millimetres instead of 32FC1 metres
+    bool                           m_depth16UC1 = false;
+
+    // optional <depth_topic_name>/compressedDepth topic
+    std::unique_ptr<CompressedDepthPublisher> m_compressedDepth;
+
+    // optional <color_topic_name>/compressed topic
+    std::unique_ptr<yarp::dev::RosImageCompression::CompressedImagePublisher> m_compressedColor;
 
     bool writeData();
+    void publishColor(const yarp::sig::FlexImage& image, const yarp::os::Stamp& stamp, UInt seq, const yarp::rosmsg::sensor_msgs::CameraInfo* camInfo);
+    void publishDepth(const DepthImage& image, const yarp::os::Stamp& stamp, UInt seq, const yarp::rosmsg::sensor_msgs::CameraInfo* camInfo);
     bool setCamInfo(yarp::rosmsg::sensor_msgs::CameraInfo& cameraInfo,
                     const std::string&                     frame_id,
                     const UInt&                            seq,
                     const SensorType&                      sensorType);
+    void updateCamInfo(const SensorType& sensorType);
+    const yarp::rosmsg::sensor_msgs::CameraInfo* getCamInfo(const SensorType& sensorType, size_t width, size_t height);
 
 public:
     RgbdSensor_nws_ros();
@@ -162,6 +233,9 @@ public:
     bool        threadInit() override;
     void        threadRelease() override;
     void        run() override;
+
+    // PortReader (statistics rpc port)
+    bool        read(yarp::os::ConnectionReader& connection) override;
 };
 
 #endif   // YARP_DEV_RGBDSENSOR_NWS_ROS_H
@@ -0,0 +1,309 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include <CompressedDepthEncoder.h>
+#include <depthConversion.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#if defined(RGBD_ROS_HAS_ZLIB)
+#  include <zlib.h>
+#endif
+
+#include <catch2/catch_amalgamated.hpp>
+#include <harness.h>
+
+namespace {
+
+// size of the ConfigHeader of compressed_depth_image_transport
+constexpr size_t CONFIG_HEADER_SIZE = 12;
+
+uint32_t getLE32(const std::uint8_t* p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// RVL decoder as in the reference implementation of the paper, reading the 32 bit words in little endian
+class RvlDecoder
+{
+public:
+    RvlDecoder(const std::uint8_t* data, const std::uint8_t* end) : m_data(data), m_end(end) {}
+
+    bool decode(std::vector<std::uint16_t>& depth, size_t count)
+    {
+        depth.assign(count, 0xFFFF);
+        size_t i = 0;
+        int32_t previous = 0;
+        while (i < count) {
+            uint32_t zeros = 0;
+            uint32_t nonzeros = 0;
+            if (!next(zeros) || zeros > count - i) {
+                return false;
+            }
+            for (; zeros > 0; zeros--) {
+                depth[i++] = 0;
+            }
+            if (!next(nonzeros) || nonzeros > count - i) {
+                return false;
+            }
+            for (; nonzeros > 0; nonzeros--) {
+                uint32_t positive = 0;
+                if (!next(positive)) {
+                    return false;
+                }
+                const int32_t delta = static_cast<int32_t>(positive >> 1) ^ -static_cast<int32_t>(positive & 1);
+                const int32_t current = previous + delta;
+                if (current <= 0 || current > 65535) {
+                    return false;
+                }
+                depth[i++] = static_cast<std::uint16_t>(current);
+                previous = current;
+            }
+        }
+        return true;
+    }
+
+    // bytes left after the last word read
+    size_t remaining() const { return static_cast<size_t>(m_end - m_data); }
+
+private:
+    bool next(uint32_t& value)
+    {
+        value = 0;
+        int bits = 29;
+        uint32_t nibble = 0;
+        do {
+            if (m_nibbles == 0) {
+                if (m_end - m_data < 4) {
+                    return false;
+                }
+                m_word = getLE32(m_data);
+                m_data += 4;
+                m_nibbles = 8;
+            }
+            nibble = m_word & 0xF0000000;
+            if (bits < 0) {
+                return false;
+            }
+            value |= (nibble << 1) >> bits;
+            m_word <<= 4;
+            m_nibbles--;
+            bits -= 3;
+        } while (nibble & 0x80000000);
+        return true;
+    }
+
+    const std::uint8_t* m_data;
+    const std::uint8_t* m_end;
+    uint32_t            m_word = 0;
+    int                 m_nibbles = 0;
+};
+
+#if defined(RGBD_ROS_HAS_ZLIB)
+uint32_t getBE32(const std::uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+// Checks the chunks of the PNG image in `data` and returns its 16 bit samples, after inflating and unfiltering them
+bool decodePng(const std::uint8_t* data, size_t size, size_t width, size_t height, std::vector<std::uint16_t>& depth)
+{
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (size < sizeof(signature) || memcmp(data, signature, sizeof(signature)) != 0) {
+        return false;
+    }
+    std::vector<std::uint8_t> compressed;
+    bool ihdr = false;
+    bool iend = false;
+    size_t pos = sizeof(signature);
+    while (pos + 12 <= size && !iend) {
+        const uint32_t length = getBE32(data + pos);
+        if (pos + 12 + length > size) {
+            return false;
+        }
+        const std::uint8_t* type = data + pos + 4;
+        const std::uint8_t* payload = data + pos + 8;
+        if (crc32(crc32(0L, Z_NULL, 0), type, length + 4) != getBE32(payload + length)) {
+            return false;
+        }
+        if (memcmp(type, "IHDR", 4) == 0) {
+            // 16 bit grayscale, deflate, adaptive filtering, no interlace
+            ihdr = length == 13 && getBE32(payload) == width && getBE32(payload + 4) == height
+                   && payload[8] == 16 && payload[9] == 0 && payload[10] == 0 && payload[11] == 0 && payload[12] == 0;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), payload, payload + length);
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            iend = length == 0;
+        }
+        pos += 12 + length;
+    }
+    if (!ihdr || !iend || pos != size) {
+        return false;
+    }
+
+    const size_t rowBytes = 1 + 2 * width;
+    std::vector<std::uint8_t> filtered(rowBytes * height);
+    uLongf filteredSize = static_cast<uLongf>(filtered.size());
+    if (uncompress(filtered.data(), &filteredSize, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK
+        || filteredSize != filtered.size()) {
+        return false;
+    }
+
+    depth.resize(width * height);
+    for (size_t r = 0; r < height; r++) {
+        std::uint8_t* row = filtered.data() + r * rowBytes;
+        // filter type 1 (Sub): each byte is stored as the difference with the byte 2 positions before
+        if (row[0] != 1) {
+            return false;
+        }
+        std::uint8_t* bytes = row + 1;
+        for (size_t i = 2; i < 2 * width; i++) {
+            bytes[i] = static_cast<std::uint8_t>(bytes[i] + bytes[i - 2]);
+        }
+        for (size_t c = 0; c < width; c++) {
+            depth[r * width + c] = static_cast<std::uint16_t>((bytes[2 * c] << 8) | bytes[2 * c + 1]);
+        }
+    }
+    return true;
+}
+#endif
+
+// Depth images with runs of NaN and 0 (no measurement), smooth surfaces, steps in both directions,
+// and values at the ends of the 16 bit range, quantized to millimetres as the publisher does
+std::vector<std::uint16_t> testImage(size_t width, size_t height, size_t variant)
+{
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    std::vector<float> metres(width * height);
+    for (size_t r = 0; r < height; r++) {
+        for (size_t c = 0; c < width; c++) {
+            float d = 0.8f + 0.001f * static_cast<float>(c) + 0.002f * static_cast<float>(r);
+            if (variant == 1) {
+                // nothing measured
+                d = (c + r) % 2 == 0 ? nan : 0.0f;
+            } else if (c % 13 < 3) {
+                d = nan;
+            } else if (r % 5 == 2 && c > width / 2) {
+                d = 0.0f;
+            } else if (c % 7 == 0) {
+                // steps to the far end of the range and back
+                d = (c / 7) % 2 == 0 ? 65.535f : 0.001f;
+            } else if (r == 3) {
+                // one long row of far samples, big deltas
+                d = 30.0f - 0.5f * static_cast<float>(c % 9);
+            }
+            metres[r * width + c] = d;
+        }
+    }
+    std::vector<std::uint16_t> depth(width * height);
+    yarp::dev::RGBDRosConversionUtils::convertFloatDepthTo16U(metres.data(), depth.data(), depth.size(), 1000.0f);
+    // the NaN runs become runs of zeros
+    bool zeros = true;
+    for (size_t i = 0; i < depth.size(); i++) {
+        zeros = zeros && (!std::isnan(metres[i]) || depth[i] == 0);
+    }
+    REQUIRE(zeros);
+    return depth;
+}
+
+bool configHeaderIsZero(const std::vector<std::uint8_t>& data)
+{
+    if (data.size() < CONFIG_HEADER_SIZE) {
+        return false;
+    }
+    for (size_t i = 0; i < CONFIG_HEADER_SIZE; i++) {
+        if (data[i] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const size_t sizes[][2] = {{1, 1}, {7, 3}, {64, 48}, {641, 11}};
+
+} // namespace
+
+TEST_CASE("dev::RgbdSensor_nws_ros::CompressedDepthEncoder", "[yarp::dev]")
+{
+    SECTION("Codec names")
+    {
+        CompressedDepthEncoder::Codec codec = CompressedDepthEncoder::Codec::PNG;
+        CHECK(CompressedDepthEncoder::parseCodec("rvl", codec));
+        CHECK(codec == CompressedDepthEncoder::Codec::RVL);
+        CHECK(CompressedDepthEncoder::parseCodec("png", codec));
+        CHECK(codec == CompressedDepthEncoder::Codec::PNG);
+        CHECK_FALSE(CompressedDepthEncoder::parseCodec("jpeg", codec));
+    }
+
+    SECTION("rvl")
+    {
+        CompressedDepthEncoder encoder(CompressedDepthEncoder::Codec::RVL, 1);
+        std::string format;
+        std::vector<std::uint8_t> data;
+        for (const auto& size : sizes) {
+            for (size_t variant : {0, 1}) {
+                const size_t width = size[0];
+                const size_t height = size[1];
+                INFO(width << "x" << height << ", variant " << variant);
+                const std::vector<std::uint16_t> depth = testImage(width, height, variant);
+                REQUIRE(encoder.encode(depth.data(), width, height, format, data));
+                CHECK(format == "16UC1; compressedDepth rvl");
+
+                // config header, then the image size as little endian 32 bit integers
+                REQUIRE(data.size() >= CONFIG_HEADER_SIZE + 8);
+                CHECK(configHeaderIsZero(data));
+                CHECK(getLE32(data.data() + CONFIG_HEADER_SIZE) == width);
+                CHECK(getLE32(data.data() + CONFIG_HEADER_SIZE + 4) == height);
+                // whole 32 bit words
+                CHECK((data.size() - CONFIG_HEADER_SIZE - 8) % 4 == 0);
+
+                RvlDecoder decoder(data.data() + CONFIG_HEADER_SIZE + 8, data.data() + data.size());
+                std::vector<std::uint16_t> decoded;
+                REQUIRE(decoder.decode(decoded, width * height));
+                CHECK(decoded == depth);
+                // the last word holds the last code, nothing follows it
+                CHECK(decoder.remaining() == 0);
+            }
+        }
+    }
+
+    SECTION("png")
+    {
+        if (!CompressedDepthEncoder::pngAvailable()) {
+            CompressedDepthEncoder encoder(CompressedDepthEncoder::Codec::PNG, 1);
+            std::string format;
+            std::vector<std::uint8_t> data;
+            const std::uint16_t depth = 1000;
+            CHECK_FALSE(encoder.encode(&depth, 1, 1, format, data));
+            YARP_SKIP_TEST("png codec not built");
+        }
+#if defined(RGBD_ROS_HAS_ZLIB)
+        for (int level : {1, 9}) {
+            CompressedDepthEncoder encoder(CompressedDepthEncoder::Codec::PNG, level);
+            std::string format;
+            std::vector<std::uint8_t> data;
+            for (const auto& size : sizes) {
+                for (size_t variant : {0, 1}) {
+                    const size_t width = size[0];
+                    const size_t height = size[1];
+                    INFO(width << "x" << height << ", variant " << variant << ", level " << level);
+                    const std::vector<std::uint16_t> depth = testImage(width, height, variant);
+                    REQUIRE(encoder.encode(depth.data(), width, height, format, data));
+                    CHECK(format == "16UC1; compressedDepth png");
+                    CHECK(configHeaderIsZero(data));
+
+                    std::vector<std::uint16_t> decoded;
+                    REQUIRE(decodePng(data.data() + CONFIG_HEADER_SIZE, data.size() - CONFIG_HEADER_SIZE, width, height, decoded));
+                    CHECK(decoded == depth);
+                }
+            }
+        }
+#endif
+    }
+}
@@ -8,9 +8,10 @@
 #include <yarp/os/LogComponent.h>
 #include <yarp/os/LogStream.h>
 #include "rosPixelCode.h"
-#include <yarp/sig/PointCloudUtils.h>
-#include <yarp/rosmsg/std_msgs/Header.h>
-#include <yarp/rosmsg/sensor_msgs/PointField.h>
+#include <yarp/os/Vocab.h>
+#include <yarp/dev/GenericVocabs.h>
+
+#include <numeric>
 
 using namespace RGBDToPointCloudImpl;
 using namespace yarp::sig;
@@ -67,6 +68,72 @@ bool RGBDToPointCloudSensor_nws_ros::open(yarp::os::Searchable &config)
     }
     frameId = config.find("frame_id").asString();
 
+    size_t threads = yarp::dev::RGBDRosConversionUtils::WorkerPool::defaultThreads();
+    if (config.check("pointcloud_threads")) {
+        int n = config.find("pointcloud_threads").asInt32();
+        if (n < 0) {
+            yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "pointcloud_threads cannot be negative";
+            return false;
+        }
+        threads = static_cast<size_t>(n);
+    }
+    m_pool = std::make_unique<yarp::dev::RGBDRosConversionUtils::WorkerPool>(threads);
+
+    m_organized = config.check("organized") && config.find("organized").asBool();
+
+    if (config.check("pixel_stride")) {
+        int stride = config.find("pixel_stride").asInt32();
+        if (stride < 1) {
+            yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "pixel_stride must be at least 1";
+            return false;
+        }
+        m_stride = static_cast<size_t>(stride);
+    }
+
+    // without min_depth and max_depth the clip planes of the sensor are used, see attach()
+    m_clipFromConfig = config.check("min_depth") || config.check("max_depth");
+    if (config.check("min_depth")) {
+        m_filter.minDepth = static_cast<float>(config.find("min_depth").asFloat64());
+    }
+    if (config.check("max_depth")) {
+        m_filter.maxDepth = static_cast<float>(config.find("max_depth").asFloat64());
+    }
+    if (m_filter.minDepth < 0 || m_filter.maxDepth < 0 || (m_filter.maxDepth > 0 && m_filter.maxDepth < m_filter.minDepth)) {
+        yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "min_depth and max_depth must be positive (or 0, no limit) and max_depth not lower than min_depth";
+        return false;
+    }
+
+    m_filter.removeInvalid = config.check("remove_invalid_points") && config.find("remove_invalid_points").asBool();
+    if (m_filter.removeInvalid && m_organized) {
+        yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "an organized cloud keeps the invalid points, remove_invalid_points and organized are mutually exclusive";
+        return false;
+    }
+
+    if (config.check("voxel_size") && config.find("voxel_size").asFloat64() != 0.0) {
+        const double voxelSize = config.find("voxel_size").asFloat64();
+        if (voxelSize < 0) {
+            yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "voxel_size cannot be negative";
+            return false;
+        }
+        if (m_organized) {
+            yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "a downsampled cloud cannot be organized, voxel_size and organized are mutually exclusive";
+            return false;
+        }
+        auto policy = yarp::dev::RGBDRosConversionUtils::VoxelGridFilter::Policy::Centroid;
+        const std::string policyName = config.check("voxel_policy") ? config.find("voxel_policy").asString() : "centroid";
+        if (policyName == "first") {
+            policy = yarp::dev::RGBDRosConversionUtils::VoxelGridFilter::Policy::First;
+        } else if (policyName != "centroid") {
+            yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "voxel_policy must be 'centroid' or 'first'";
+            return false;
+        }
+        m_voxelGrid = std::make_unique<yarp::dev::RGBDRosConversionUtils::VoxelGridFilter>(voxelSize, policy);
+    }
+
+    if (config.check("publish_only_new_frames")) {
+        m_publishOnlyNewFrames = config.find("publish_only_new_frames").asBool();
+    }
+
     // open topics here if needed
     m_node = new yarp::os::Node(nodeName);
     nodeSeq = 0;
@@ -75,12 +142,25 @@ bool RGBDToPointCloudSensor_nws_ros::open(yarp::os::Searchable &config)
         yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "Unable to publish data on " << pointCloudTopicName.c_str() << " topic, check your yarp-ROS network configuration";
         return false;
     }
+
+    if (config.check("stats_port_name")) {
+        std::string stats_port_name = config.find("stats_port_name").asString();
+        if (!m_stats_port.open(stats_port_name)) {
+            yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "Failed to open port" << stats_port_name;
+            // releases the node created above
+            close();
+            return false;
+        }
+        m_stats_port.setReader(*this);
+    }
+
     return true;
 }
 
 bool RGBDToPointCloudSensor_nws_ros::close()
 {
     yCTrace(RGBDTOPOINTCLOUDSENSORNWSROS, "Close");
+    m_stats_port.close();
     detach();
 
     if(m_node !=nullptr)
@@ -122,6 +202,18 @@ bool RGBDToPointCloudSensor_nws_ros::attach(PolyDriver* poly)
         return false;
     }
 
+    if (!m_clipFromConfig)
+    {
+        double nearPlane = 0;
+        double farPlane = 0;
+        if (sensor_p->getDepthClipPlanes(nearPlane, farPlane))
+        {
+            // non positive planes mean no limit
+            m_filter.minDepth = nearPlane > 0 ? static_cast<float>(nearPlane) : 0.0f;
+            m_filter.maxDepth = farPlane > 0 ? static_cast<float>(farPlane) : 0.0f;
+        }
+    }
+
     PeriodicThread::setPeriod(period);
     return PeriodicThread::start();
 }
@@ -147,30 +239,29 @@ bool RGBDToPointCloudSensor_nws_ros::writeData()
 
     //             colorImage.resize(hDim, vDim);  // Has this to be done each time? If size is the same what it does?
     //             depthImage.resize(hDim, vDim);
-    if (!sensor_p->getImages(colorImage, depthImage, &colorStamp, &depthStamp))
+
+    // neither grab the images nor build the cloud if nobody is listening
+    if (publisherPort_pointCloud.getOutputCount() == 0)
     {
-        return false;
+        return true;
     }
 
-    static Stamp oldColorStamp = Stamp(0, 0);
-    static Stamp oldDepthStamp = Stamp(0, 0);
-    yarp::os::Property propIntrinsic;
-    bool rgb_data_ok = true;
-    bool depth_data_ok = true;
-
-    if ((colorStamp.getTime() - oldColorStamp.getTime()) <= 0)
+    if (!sensor_p->getImages(colorImage, depthImage, &colorStamp, &depthStamp))
     {
-        rgb_data_ok=false;
-        //return true;
+        return false;
     }
-    else { oldColorStamp = colorStamp; }
 
-    if ((depthStamp.getTime() - oldDepthStamp.getTime()) <= 0)
+    yarp::os::Property propIntrinsic;
+    // frames whose stamp did not change since the previous cycle have already been published
+    const uint64_t duplicates = m_colorFrames.duplicates() + m_depthFrames.duplicates();
+    bool rgb_data_ok = m_colorFrames.isNew(colorStamp) || !m_publishOnlyNewFrames;
+    bool depth_data_ok = m_depthFrames.isNew(depthStamp) || !m_publishOnlyNewFrames;
+    if (m_colorFrames.duplicates() + m_depthFrames.duplicates() != duplicates)
     {
-        depth_data_ok=false;
-        //return true;
+        yCDebugThrottle(RGBDTOPOINTCLOUDSENSORNWSROS, 30, "Frames with an unchanged stamp so far: %llu color, %llu depth",
+                        static_cast<unsigned long long>(m_colorFrames.duplicates()),
+                        static_cast<unsigned long long>(m_depthFrames.duplicates()));
     }
-    else { oldDepthStamp = depthStamp; }
     bool intrinsic_ok = sensor_p->getRgbIntrinsicParam(propIntrinsic);
 
 
@@ -182,55 +273,73 @@ bool RGBDToPointCloudSensor_nws_ros::writeData()
             if (intrinsic_ok)
             {
                 yarp::sig::IntrinsicParams intrinsics(propIntrinsic);
-                yarp::sig::ImageOf<yarp::sig::PixelRgb> colorImagePixelRGB;
-                colorImagePixelRGB.setExternal(colorImage.getRawImage(), colorImage.width(), colorImage.height());
-                // create point cloud in yarp format
-                yarp::sig::PointCloud<yarp::sig::DataXYZRGBA> yarpCloud = yarp::sig::utils::depthRgbToPC<yarp::sig::DataXYZRGBA,
-                                                                                                         yarp::sig::PixelRgb>(depthImage,
-                                                                                                                              colorImagePixelRGB,
-                                                                                                                              intrinsics,
-                                                                                                                              yarp::sig::utils::OrganizationType::Unorganized);
+                const size_t width = depthImage.width();
+                const size_t height = depthImage.height();
+                if (colorImage.width() != width || colorImage.height() != height)
+                {
+                    yCWarningThrottle(RGBDTOPOINTCLOUDSENSORNWSROS, 5, "Color (%zux%zu) and depth (%zux%zu) images have different sizes, no point cloud published",
+                                      colorImage.width(), colorImage.height(), width, height);
+                    return true;
+                }
+                if (!yarp::dev::RGBDRosConversionUtils::isBackprojectionSupported(colorImage.getPixelCode()))
+                {
+                    yCWarningThrottle(RGBDTOPOINTCLOUDSENSORNWSROS, 5, "Unsupported color pixel code %s, no point cloud published",
+                                      yarp::os::Vocab32::decode(colorImage.getPixelCode()).c_str());
+                    return true;
+                }
+                m_rays.update(intrinsics, width, height, m_stride);
+                const size_t columns = m_rays.width();
+                const size_t rows = m_rays.height();
+
+                // the rejected pixels are not written: every row gets the slice for its valid pixels only
+                size_t points = columns * rows;
+                const size_t* rowOffsets = nullptr;
+                if (m_filter.removeInvalid)
+                {
+                    m_rowOffsets.resize(rows + 1);
+                    m_rowOffsets[0] = 0;
+                    m_pool->parallelFor(0, rows, [&](size_t rowBegin, size_t rowEnd) {
+                        for (size_t r = rowBegin; r < rowEnd; r++) {
+                            m_rowOffsets[r + 1] = yarp::dev::RGBDRosConversionUtils::countValidPoints(depthImage, m_rays, m_filter, r);
+                        }
+                    });
+                    std::partial_sum(m_rowOffsets.begin(), m_rowOffsets.end(), m_rowOffsets.begin());
+                    points = m_rowOffsets[rows];
+                    rowOffsets = m_rowOffsets.data();
+                }
+
                 PointCloud2Type& pc2Ros = publisherPort_pointCloud.prepare();
                 // filling ros header
-                yarp::rosmsg::std_msgs::Header headerRos;
-                headerRos.clear();
-                headerRos.seq = nodeSeq;
-                headerRos.frame_id = frameId;
-                headerRos.stamp = depthStamp.getTime();
-
-                // filling ros point field
-                std::vector<yarp::rosmsg::sensor_msgs::PointField> pointFieldRos;
-                pointFieldRos.push_back(yarp::rosmsg::sensor_msgs::PointField());
-                pointFieldRos.push_back(yarp::rosmsg::sensor_msgs::PointField());
-                pointFieldRos.push_back(yarp::rosmsg::sensor_msgs::PointField());
-                pointFieldRos.push_back(yarp::rosmsg::sensor_msgs::PointField());
-                pointFieldRos[0].name = "x";
-                pointFieldRos[0].offset = 0;
-                pointFieldRos[0].datatype = 7;
-                pointFieldRos[0].count = 1;
-                pointFieldRos[1].name = "y";
-                pointFieldRos[1].offset = 4;
-                pointFieldRos[1].datatype = 7;
-                pointFieldRos[1].count = 1;
-                pointFieldRos[2].name = "z";
-                pointFieldRos[2].offset = 8;
-                pointFieldRos[2].datatype = 7;
-                pointFieldRos[2].count = 1;
-                pointFieldRos[3].name = "rgb";
-                pointFieldRos[3].offset = 16;
-                pointFieldRos[3].datatype = 7;
-                pointFieldRos[3].count = 1;
-                pc2Ros.fields = pointFieldRos;
-
-                std::vector<unsigned char> vec(yarpCloud.getRawData(), yarpCloud.getRawData() + yarpCloud.dataSizeBytes() );
-                pc2Ros.data = vec;
-                pc2Ros.header = headerRos;
-                pc2Ros.width = yarpCloud.width() * yarpCloud.height();
-                pc2Ros.height = 1;
-                pc2Ros.is_dense = yarpCloud.isDense();
-
-                pc2Ros.point_step = sizeof (yarp::sig::DataXYZRGBA);
-                pc2Ros.row_step   = static_cast<std::uint32_t> (sizeof (yarp::sig::DataXYZRGBA) * pc2Ros.width);
+                pc2Ros.header.seq = nodeSeq;
+                pc2Ros.header.frame_id = frameId;
+                pc2Ros.header.stamp = depthStamp.getTime();
+
+                yarp::dev::RGBDRosConversionUtils::fillPointXYZRGBFields(pc2Ros.fields);
+
+                // the points are written straight into the message buffer, whose capacity is kept across frames,
+                // unless they still have to be downsampled
+                std::vector<std::uint8_t>& fullCloud = m_voxelGrid ? m_fullCloud : pc2Ros.data;
+                fullCloud.resize(points * yarp::dev::RGBDRosConversionUtils::POINT_XYZRGB_STEP);
+                // every band of rows writes its own slice of the buffer
+                unsigned char* cloud = fullCloud.data();
+                m_pool->parallelFor(0, rows, [&](size_t rowBegin, size_t rowEnd) {
+                    yarp::dev::RGBDRosConversionUtils::backprojectRows(depthImage, colorImage, m_rays, m_filter, rowBegin, rowEnd, cloud, rowOffsets);
+                });
+
+                if (m_voxelGrid)
+                {
+                    points = m_voxelGrid->filter(cloud, points, pc2Ros.data);
+                }
+
+                // the organized cloud keeps the pixel neighbourhood: point (u, v) is the pixel (u, v)
+                pc2Ros.width = m_organized ? columns : points;
+                pc2Ros.height = m_organized ? rows : 1;
+                // pixels without a valid depth are NaN points, unless removed here or by the voxel grid
+                pc2Ros.is_dense = m_filter.removeInvalid || m_voxelGrid != nullptr;
+                pc2Ros.is_bigendian = false;
+
+                pc2Ros.point_step = yarp::dev::RGBDRosConversionUtils::POINT_XYZRGB_STEP;
+                pc2Ros.row_step   = static_cast<std::uint32_t> (yarp::dev::RGBDRosConversionUtils::POINT_XYZRGB_STEP * pc2Ros.width);
 
                 publisherPort_pointCloud.write();
             }
@@ -242,11 +351,56 @@ bool RGBDToPointCloudSensor_nws_ros::writeData()
     return true;
 }
 
+bool RGBDToPointCloudSensor_nws_ros::read(yarp::os::ConnectionReader& connection)
+{
+    yarp::os::Bottle command;
+    yarp::os::Bottle reply;
+    bool ok = command.read(connection);
+    if (!ok) {
+        return false;
+    }
+
+    reply.clear();
+
+    const std::string cmd = command.get(0).asString();
+    if (cmd == "help")
+    {
+        reply.addVocab32("many");
+        reply.addString("stats: returns the number of color and depth frames returned again by the sensor (unchanged stamp)");
+    }
+    else if (cmd == "stats")
+    {
+        yarp::os::Bottle& color = reply.addList();
+        color.addString("color");
+        yarp::os::Bottle& colorDuplicates = color.addList();
+        colorDuplicates.addString("duplicates");
+        colorDuplicates.addInt64(static_cast<int64_t>(m_colorFrames.duplicates()));
+        yarp::os::Bottle& depth = reply.addList();
+        depth.addString("depth");
+        yarp::os::Bottle& depthDuplicates = depth.addList();
+        depthDuplicates.addString("duplicates");
+        depthDuplicates.addInt64(static_cast<int64_t>(m_depthFrames.duplicates()));
+    }
+    else
+    {
+        yCError(RGBDTOPOINTCLOUDSENSORNWSROS) << "Invalid command. Try `help`";
+        reply.addVocab32(VOCAB_ERR);
+    }
+
+    yarp::os::ConnectionWriter* returnToSender = connection.getWriter();
+    if (returnToSender != nullptr)
+    {
+        reply.write(*returnToSender);
+    }
+
+    return true;
+}
+
 void RGBDToPointCloudSensor_nws_ros::run()
 {
     if (sensor_p!=nullptr)
     {
-        static int i = 0;
+        int& i = m_notReadyCount;
         sensorStatus = sensor_p->getSensorStatus();
         switch (sensorStatus)
         {
@@ -8,6 +8,7 @@
 
 #include <vector>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <sstream>
 
@@ -17,6 +18,8 @@
 #include <yarp/os/Network.h>
 #include <yarp/os/Property.h>
 #include <yarp/os/PeriodicThread.h>
+#include <yarp/os/PortReader.h>
+#include <yarp/os/RpcServer.h>
 
 #include <yarp/sig/Vector.h>
 
@@ -32,6 +35,11 @@
 #include <yarp/rosmsg/TickTime.h>
 #include <yarp/rosmsg/sensor_msgs/PointCloud2.h>
 
+#include <frameChangeDetector.h>
+#include <pointCloudBackprojection.h>
+#include <voxelGridFilter.h>
+#include <workerPool.h>
+
 constexpr double DEFAULT_THREAD_PERIOD = 0.033; // s
 
 namespace RGBDToPointCloudImpl{
@@ -56,6 +64,16 @@ namespace RGBDToPointCloudImpl{
  * | topic_name             |      -                  | string  |  -             |               |  Yes                            | set the name for ROS point cloud topic                                                              | must start with a leading '/' |
  * | frame_id               |      -                  | string  |  -             |               |  Yes                            | set the name of the reference frame                                                                 |                               |
  * | node_name              |      -                  | string  |  -             |   -           |  Yes                            | set the name for ROS node                                                                           | must start with a leading '/' |
+ * | pointcloud_threads     |      -                  | int     |  -             |   cores - 1   |  No                             | worker threads building the point cloud, besides the publishing one                                 | the image is split in bands of rows |
+ * | organized              |      -                  | bool    |  -             |   false       |  No                             | if 'true' the cloud keeps the image layout (height = image rows, one point per pixel)                | pixels without a valid depth are NaN points |
+ * | pixel_stride           |      -                  | int     |  -             |   1           |  No                             | only one pixel every pixel_stride columns and rows is converted into a point                        | the organized cloud has the size of the sampled grid |
+ * | min_depth              |      -                  | double  |  m             |   -           |  No                             | points closer than min_depth are invalid, 0 means no limit                                          | without min_depth and max_depth the sensor clip planes (getDepthClipPlanes) are used, if available |
+ * | max_depth              |      -                  | double  |  m             |   -           |  No                             | points farther than max_depth are invalid, 0 means no limit                                         |       |
+ * | remove_invalid_points  |      -                  | bool    |  -             |   false       |  No                             | if 'true' the invalid points are not published instead of being NaN points (dense cloud)            | cannot be used with organized |
+ * | voxel_size             |      -                  | double  |  m             |   0           |  No                             | edge of the voxels of the downsampling grid, 0 disables the downsampling                            | one point per occupied voxel is published, cannot be used with organized |
+ * | voxel_policy           |      -                  | string  |  -             |   centroid    |  No                             | point published for each voxel: 'centroid' (mean position and color of its points) or 'first'       |       |
+ * | publish_only_new_frames |      -                 | bool    |  -             |   true        |  No                             | if 'true' no point cloud is published when the sensor returns again the same frames (same stamps)   | set to 'false' for sensors that do not update the stamps |
+ * | stats_port_name        |      -                  | string  | -              |   -           |  No                             | if set, an rpc port with this name answers `stats` (frames returned again by the sensor, per stream) and `help` | -                                                                        |
  *
  * ROS message type used is sensor_msgs/Image.msg ( http://docs.ros.org/en/api/sensor_msgs/html/msg/PointCloud2.html)
  * Some example of configuration files:
@@ -75,7 +93,8 @@ namespace RGBDToPointCloudImpl{
 class RGBDToPointCloudSensor_nws_ros :
         public yarp::dev::DeviceDriver,
         public yarp::dev::WrapperSingle,
-        public yarp::os::PeriodicThread
+        public yarp::os::PeriodicThread,
+        public yarp::os::PortReader
 {
 private:
     // defining types for shorter names
@@ -109,6 +128,19 @@ private:
     DepthImage            depthImage;
     UInt                  nodeSeq = 0;
 
+    // viewing rays of the depth pixels, rebuilt only when the intrinsics or the image size change
+    yarp::dev::RGBDRosConversionUtils::RayTable m_rays;
+    // splits the point cloud generation in bands of rows
+    std::unique_ptr<yarp::dev::RGBDRosConversionUtils::WorkerPool> m_pool;
+    // optional downsampling, the full cloud is built in m_fullCloud first
+    std::unique_ptr<yarp::dev::RGBDRosConversionUtils::VoxelGridFilter> m_voxelGrid;
+    std::vector<std::uint8_t>                                          m_fullCloud;
+    // pixel sampling, accepted depth range and removal of the invalid points
+    size_t                                                             m_stride = 1;
+    yarp::dev::RGBDRosConversionUtils::BackprojectionFilter            m_filter;
+    bool                                                               m_clipFromConfig = false;
+    std::vector<size_t>                                                m_rowOffsets;
+
 
     // this is the sub device or the real device
 
@@ -129,6 +161,12 @@ private:
     // Synch
     yarp::os::Stamp                colorStamp;
     yarp::os::Stamp                depthStamp;
+    yarp::dev::RGBDRosConversionUtils::FrameChangeDetector m_colorFrames;
+    yarp::dev::RGBDRosConversionUtils::FrameChangeDetector m_depthFrames;
+    yarp::os::RpcServer            m_stats_port;
+    bool                           m_publishOnlyNewFrames = true;
+    bool                           m_organized = false;
+    int                            m_notReadyCount = 0;
     yarp::os::Property             m_conf;
 
     bool writeData();
@@ -154,6 +192,9 @@ public:
     bool        threadInit() override;
     void        threadRelease() override;
     void        run() override;
+
+    // PortReader (statistics rpc port)
+    bool        read(yarp::os::ConnectionReader& connection) override;
 };
 
 #endif   // YARP_DEV_RGBDTOPOINTCLOUDSENSOR_NWS_ROS_H
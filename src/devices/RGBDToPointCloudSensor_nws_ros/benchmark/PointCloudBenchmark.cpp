@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+/*
+ * Measures the point cloud generation of RGBDToPointCloudSensor_nws_ros (backprojection of a depth
+ * and color pair into a PointCloud2 buffer) with an increasing number of threads.
+ *
+ * Usage: benchmark_RGBDToPointCloud [width height frames max_threads]
+ * (defaults: 1280 720 200 and the hardware threads)
+ */
+
+#include <pointCloudBackprojection.h>
+#include <workerPool.h>
+
+#include <yarp/sig/Image.h>
+#include <yarp/sig/IntrinsicParams.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using namespace yarp::dev::RGBDRosConversionUtils;
+
+int main(int argc, char* argv[])
+{
+    const size_t width = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1280;
+    const size_t height = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 720;
+    const size_t frames = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200;
+    size_t maxThreads = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : std::thread::hardware_concurrency();
+    if (width == 0 || height == 0 || frames == 0) {
+        std::fprintf(stderr, "Usage: %s [width height frames max_threads]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    // a tilted plane, with some invalid pixels as real sensors return
+    yarp::sig::ImageOf<yarp::sig::PixelFloat> depth;
+    depth.resize(width, height);
+    yarp::sig::FlexImage color;
+    color.setPixelCode(VOCAB_PIXEL_RGB);
+    color.resize(width, height);
+    for (size_t v = 0; v < height; v++) {
+        auto* d = reinterpret_cast<float*>(depth.getRow(v));
+        unsigned char* c = color.getRow(v);
+        for (size_t u = 0; u < width; u++) {
+            d[u] = (u * 7 + v * 13) % 97 == 0 ? 0.0f : 0.5f + 3.0f * static_cast<float>(v) / static_cast<float>(height);
+            c[3 * u] = static_cast<unsigned char>(u);
+            c[3 * u + 1] = static_cast<unsigned char>(v);
+            c[3 * u + 2] = static_cast<unsigned char>(u + v);
+        }
+    }
+
+    yarp::sig::IntrinsicParams intrinsics;
+    intrinsics.focalLengthX = 0.8 * width;
+    intrinsics.focalLengthY = 0.8 * width;
+    intrinsics.principalPointX = 0.5 * width;
+    intrinsics.principalPointY = 0.5 * height;
+    RayTable rays;
+    rays.update(intrinsics, width, height);
+    const BackprojectionFilter filter;
+
+    std::vector<std::uint8_t> cloud(width * height * POINT_XYZRGB_STEP);
+
+    std::printf("%zux%zu, %zu frames\n", width, height, frames);
+    std::printf("threads   ms/frame   frames/s   speedup\n");
+    double single = 0;
+    for (size_t threads = 1; threads <= maxThreads; threads++) {
+        // the calling thread takes part in the work as in the device
+        WorkerPool pool(threads - 1);
+        auto body = [&](size_t rowBegin, size_t rowEnd) {
+            backprojectRows(depth, color, rays, filter, rowBegin, rowEnd, cloud.data());
+        };
+        // warm up the threads and the caches
+        pool.parallelFor(0, height, body);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < frames; i++) {
+            pool.parallelFor(0, height, body);
+        }
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        const double ms = elapsed.count() / static_cast<double>(frames);
+        if (threads == 1) {
+            single = ms;
+        }
+        std::printf("%7zu %10.3f %10.1f %9.2f\n", threads, ms, 1000.0 / ms, single / ms);
+    }
+    return EXIT_SUCCESS;
+}
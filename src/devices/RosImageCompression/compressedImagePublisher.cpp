@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "compressedImagePublisher.h"
+
+#include <rosPixelCode.h>
+
+#include <cstring>
+#include <utility>
+
+using namespace yarp::dev::RosImageCompression;
+
+CompressedImagePublisher::CompressedImagePublisher(int quality, size_t threads) :
+        m_quality(quality)
+{
+    for (size_t i = 0; i < (threads > 0 ? threads : 1); i++) {
+        m_encoders.push_back(std::make_unique<JpegEncoder>());
+    }
+}
+
+CompressedImagePublisher::~CompressedImagePublisher()
+{
+    close();
+}
+
+bool CompressedImagePublisher::open(const std::string& topic, const std::string& frameId)
+{
+    if (!m_publisher.topic(topic)) {
+        return false;
+    }
+    m_frameId = frameId;
+    m_stop = false;
+    for (size_t i = 0; i < m_encoders.size(); i++) {
+        m_threads.emplace_back(&CompressedImagePublisher::run, this, i);
+    }
+    return true;
+}
+
+void CompressedImagePublisher::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+    m_threads.clear();
+    m_publisher.close();
+}
+
+int CompressedImagePublisher::getOutputCount()
+{
+    return m_publisher.getOutputCount();
+}
+
+bool CompressedImagePublisher::post(const yarp::sig::Image& image, const yarp::os::Stamp& stamp, unsigned int seq)
+{
+    if (!JpegEncoder::isSupported(image.getPixelCode())) {
+        return false;
+    }
+
+    std::unique_ptr<Frame> frame;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free.empty()) {
+            frame = std::move(m_free.back());
+            m_free.pop_back();
+        }
+    }
+    if (!frame) {
+        frame = std::make_unique<Frame>();
+    }
+
+    // the caller reuses its buffer for the next frame
+    frame->image.setPixelCode(image.getPixelCode());
+    frame->image.resize(image.width(), image.height());
+    const size_t rowBytes = image.width() * image.getPixelSize();
+    for (size_t r = 0; r < image.height(); r++) {
+        memcpy(frame->image.getRow(r), image.getRow(r), rowBytes);
+    }
+    frame->stamp = stamp;
+    frame->seq = seq;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        frame->order = ++m_posted;
+        if (m_pending) {
+            m_free.push_back(std::move(m_pending));
+        }
+        m_pending = std::move(frame);
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+void CompressedImagePublisher::run(size_t worker)
+{
+    JpegEncoder& encoder = *m_encoders[worker];
+    while (true) {
+        std::unique_ptr<Frame> frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stop || m_pending; });
+            if (m_stop) {
+                return;
+            }
+            frame = std::move(m_pending);
+        }
+
+        if (encoder.encode(frame->image, m_quality, frame->jpeg)) {
+            send(*frame);
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_free.push_back(std::move(frame));
+    }
+}
+
+void CompressedImagePublisher::send(Frame& frame)
+{
+    std::lock_guard<std::mutex> lock(m_write_mutex);
+    if (frame.order <= m_written) {
+        // a newer frame was encoded faster
+        return;
+    }
+    m_written = frame.order;
+
+    const int code = frame.image.getPixelCode();
+    yarp::rosmsg::sensor_msgs::CompressedImage& msg = m_publisher.prepare();
+    msg.header.frame_id = m_frameId;
+    msg.header.seq = frame.seq;
+    msg.header.stamp = frame.stamp.getTime();
+    // "<original encoding>; jpeg compressed <decoded encoding>", as written by compressed_image_transport
+    msg.format = yarp::dev::ROSPixelCode::yarp2RosPixelCode(code) + (code == VOCAB_PIXEL_MONO ? "; jpeg compressed mono8" : "; jpeg compressed bgr8");
+    // the buffer of the message, no longer in use, is recycled for a next frame
+    msg.data.swap(frame.jpeg);
+    m_publisher.setEnvelope(frame.stamp);
+    m_publisher.write();
+}
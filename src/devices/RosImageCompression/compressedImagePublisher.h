@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ROS_IMAGE_COMPRESSION_COMPRESSED_IMAGE_PUBLISHER_H
+#define ROS_IMAGE_COMPRESSION_COMPRESSED_IMAGE_PUBLISHER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <yarp/os/Publisher.h>
+#include <yarp/os/Stamp.h>
+#include <yarp/rosmsg/sensor_msgs/CompressedImage.h>
+#include <yarp/sig/Image.h>
+
+#include "jpegEncoder.h"
+
+namespace yarp::dev::RosImageCompression {
+
+/**
+ * Publishes JPEG compressed images on a topic compatible with the `compressed` plugin of image_transport
+ * (conventionally `<image topic>/compressed`).
+ *
+ * post() copies the image and returns immediately, the encoding runs on a pool of threads so that
+ * consecutive frames can be encoded concurrently. When all the threads are busy, an image waiting to be
+ * encoded is replaced by the newer one, and a frame finishing after a newer one has already been sent is
+ * dropped, so the messages are always published in order.
+ */
+class CompressedImagePublisher
+{
+public:
+    /**
+     * @param quality JPEG quality (1-100)
+     * @param threads number of encoding threads (at least 1)
+     */
+    CompressedImagePublisher(int quality, size_t threads);
+    CompressedImagePublisher(const CompressedImagePublisher&) = delete;
+    CompressedImagePublisher& operator=(const CompressedImagePublisher&) = delete;
+    ~CompressedImagePublisher();
+
+    bool open(const std::string& topic, const std::string& frameId);
+    void close();
+
+    int getOutputCount();
+
+    /**
+     * Queues `image` for encoding. Returns false if its pixel code is not supported by the encoder.
+     */
+    bool post(const yarp::sig::Image& image, const yarp::os::Stamp& stamp, unsigned int seq);
+
+private:
+    struct Frame
+    {
+        yarp::sig::FlexImage      image;
+        yarp::os::Stamp           stamp;
+        unsigned int              seq = 0;
+        std::uint64_t             order = 0;
+        std::vector<std::uint8_t> jpeg;
+    };
+
+    void run(size_t worker);
+    void send(Frame& frame);
+
+    yarp::os::Publisher<yarp::rosmsg::sensor_msgs::CompressedImage> m_publisher;
+    int                                                             m_quality;
+    std::string                                                     m_frameId;
+    std::vector<std::unique_ptr<JpegEncoder>>                       m_encoders;
+
+    std::vector<std::unique_ptr<Frame>> m_free;
+    std::unique_ptr<Frame>              m_pending;
+    std::uint64_t                       m_posted = 0;
+    bool                                m_stop = false;
+    std::mutex                          m_mutex;
+    std::condition_variable             m_cv;
+    std::vector<std::thread>            m_threads;
+
+    // serializes the writes and keeps them in order
+    std::mutex    m_write_mutex;
+    std::uint64_t m_written = 0;
+};
+
+} // namespace yarp::dev::RosImageCompression
+
+#endif // ROS_IMAGE_COMPRESSION_COMPRESSED_IMAGE_PUBLISHER_H
@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "jpegEncoder.h"
+
+#include <yarp/conf/compiler.h>
+
+#include <pixelConversion.h>
+
+#if defined(RGBD_ROS_HAS_JPEG)
+#  include <algorithm>
+#  include <csetjmp>
+#  include <cstdio>
+#  include <jpeglib.h>
+#endif
+
+using namespace yarp::dev::RosImageCompression;
+
+#if defined(RGBD_ROS_HAS_JPEG)
+
+namespace {
+
+// initial size of the output buffer, doubled whenever libjpeg fills it
+constexpr size_t INITIAL_OUTPUT_SIZE = 64 * 1024;
+
+// the default libjpeg error handler calls exit()
+struct ErrorManager
+{
+    jpeg_error_mgr pub;
+    jmp_buf        jump;
+};
+
+void errorExit(j_common_ptr cinfo)
+{
+    longjmp(reinterpret_cast<ErrorManager*>(cinfo->err)->jump, 1);
+}
+
+void outputMessage(j_common_ptr /*cinfo*/)
+{
+}
+
+// destination manager writing straight into a std::vector, reusing its capacity
+struct VectorDestination
+{
+    jpeg_destination_mgr       pub;
+    std::vector<std::uint8_t>* data;
+};
+
+void initDestination(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+    dest->data->resize(std::max(dest->data->capacity(), INITIAL_OUTPUT_SIZE));
+    dest->pub.next_output_byte = dest->data->data();
+    dest->pub.free_in_buffer = dest->data->size();
+}
+
+boolean emptyOutputBuffer(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+    const size_t used = dest->data->size();
+    dest->data->resize(2 * used);
+    dest->pub.next_output_byte = dest->data->data() + used;
+    dest->pub.free_in_buffer = dest->data->size() - used;
+    return TRUE;
+}
+
+void termDestination(j_compress_ptr cinfo)
+{
+    auto* dest = reinterpret_cast<VectorDestination*>(cinfo->dest);
+    dest->data->resize(dest->data->size() - dest->pub.free_in_buffer);
+}
+
+} // namespace
+
+struct JpegEncoder::Private
+{
+    jpeg_compress_struct      cinfo;
+    ErrorManager              error;
+    VectorDestination         destination;
+    std::vector<std::uint8_t> row;
+};
+
+JpegEncoder::JpegEncoder() :
+        mPriv(std::make_unique<Private>())
+{
+    mPriv->cinfo.err = jpeg_std_error(&mPriv->error.pub);
+    mPriv->error.pub.error_exit = errorExit;
+    mPriv->error.pub.output_message = outputMessage;
+    jpeg_create_compress(&mPriv->cinfo);
+
+    mPriv->destination.pub.init_destination = initDestination;
+    mPriv->destination.pub.empty_output_buffer = emptyOutputBuffer;
+    mPriv->destination.pub.term_destination = termDestination;
+    mPriv->destination.data = nullptr;
+    mPriv->cinfo.dest = &mPriv->destination.pub;
+}
+
+JpegEncoder::~JpegEncoder()
+{
+    jpeg_destroy_compress(&mPriv->cinfo);
+}
+
+bool JpegEncoder::available()
+{
+    return true;
+}
+
+bool JpegEncoder::encode(const yarp::sig::Image& image, int quality, std::vector<std::uint8_t>& data)
+{
+    const int code = image.getPixelCode();
+    if (!isSupported(code) || image.width() == 0 || image.height() == 0) {
+        return false;
+    }
+
+    Private& p = *mPriv;
+    jpeg_compress_struct& cinfo = p.cinfo;
+    p.destination.data = &data;
+    p.row.resize(3 * image.width());
+
+    if (setjmp(p.error.jump) != 0) {
+        jpeg_abort_compress(&cinfo);
+        return false;
+    }
+
+    cinfo.image_width = static_cast<JDIMENSION>(image.width());
+    cinfo.image_height = static_cast<JDIMENSION>(image.height());
+    cinfo.input_components = code == VOCAB_PIXEL_MONO ? 1 : 3;
+    cinfo.in_color_space = code == VOCAB_PIXEL_MONO ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, quality, TRUE);
+    // the integer DCT is noticeably faster and the loss of accuracy is negligible for streaming
+    cinfo.dct_method = JDCT_IFAST;
+
+    jpeg_start_compress(&cinfo, TRUE);
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const unsigned char* src = image.getRow(cinfo.next_scanline);
+        JSAMPROW row = p.row.data();
+        switch (code) {
+        case VOCAB_PIXEL_BGR:
+            yarp::dev::RGBDRosConversionUtils::convertBgrToRgb(src, row, image.width());
+            break;
+        case VOCAB_PIXEL_RGBA:
+            yarp::dev::RGBDRosConversionUtils::convertRgbaToRgb(src, row, image.width());
+            break;
+        case VOCAB_PIXEL_BGRA:
+            yarp::dev::RGBDRosConversionUtils::convertBgraToRgb(src, row, image.width());
+            break;
+        default:
+            // mono and rgb rows are passed as they are, libjpeg does not modify them
+            row = const_cast<JSAMPROW>(src);
+            break;
+        }
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    return true;
+}
+
+#else // RGBD_ROS_HAS_JPEG
+
+struct JpegEncoder::Private
+{
+};
+
+JpegEncoder::JpegEncoder() = default;
+
+JpegEncoder::~JpegEncoder() = default;
+
+bool JpegEncoder::available()
+{
+    return false;
+}
+
+bool JpegEncoder::encode(const yarp::sig::Image& image, int quality, std::vector<std::uint8_t>& data)
+{
+    YARP_UNUSED(image);
+    YARP_UNUSED(quality);
+    YARP_UNUSED(data);
+    return false;
+}
+
+#endif // RGBD_ROS_HAS_JPEG
+
+bool JpegEncoder::isSupported(int pixelCode)
+{
+    switch (pixelCode) {
+    case VOCAB_PIXEL_MONO:
+    case VOCAB_PIXEL_RGB:
+    case VOCAB_PIXEL_BGR:
+    case VOCAB_PIXEL_RGBA:
+    case VOCAB_PIXEL_BGRA:
+        return true;
+    default:
+        return false;
+    }
+}
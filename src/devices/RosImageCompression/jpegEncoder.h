@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: 2006-2023 Istituto Italiano di Tecnologia (IIT)
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef ROS_IMAGE_COMPRESSION_JPEG_ENCODER_H
+#define ROS_IMAGE_COMPRESSION_JPEG_ENCODER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <yarp/sig/Image.h>
+
+namespace yarp::dev::RosImageCompression {
+
+/**
+ * JPEG encoder for 8 bit images (mono, rgb, bgr, rgba and bgra pixel codes).
+ * Color images are encoded as RGB; the libjpeg state is kept across calls, so an encoder
+ * should be reused for consecutive frames, by one thread at a time.
+ */
+class JpegEncoder
+{
+public:
+    JpegEncoder();
+    ~JpegEncoder();
+
+    JpegEncoder(const JpegEncoder&) = delete;
+    JpegEncoder& operator=(const JpegEncoder&) = delete;
+
+    /**
+     * Whether JPEG support was built in (libjpeg found at build time).
+     */
+    static bool available();
+
+    /**
+     * Whether images with pixel code `pixelCode` can be encoded.
+     */
+    static bool isSupported(int pixelCode);
+
+    /**
+     * Replaces `data` with the JPEG encoding of `image` at `quality` (1-100). Returns false on failure.
+     */
+    bool encode(const yarp::sig::Image& image, int quality, std::vector<std::uint8_t>& data);
+
+private:
+    struct Private;
+    std::unique_ptr<Private> mPriv;
+};
+
+} // namespace yarp::dev::RosImageCompression
+
+#endif // ROS_IMAGE_COMPRESSION_JPEG_ENCODER_H